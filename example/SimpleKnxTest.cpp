@@ -27,9 +27,10 @@
 #define KNX_SERIAL Serial
 #define TEST_LED LED_BUILTIN
 
-// I am not a c++ expert, if there is a more elegant way in doing
-// this, please let me know.
-word SimpleKnx_::_groupAddressList[] = {
+// group addresses of this device, stored in flash. They must be listed in
+// ascending order (main, middle, then sub group) without duplicates, the
+// library does not sort them and compilation fails otherwise
+KNX_GROUP_ADDRESSES(
     G_ADDR(2,7,1),
     G_ADDR(2,7,2),
     G_ADDR(2,7,3),
@@ -39,8 +40,7 @@ word SimpleKnx_::_groupAddressList[] = {
     G_ADDR(2,7,7),
     G_ADDR(2,7,8),
     G_ADDR(2,7,9)
-};
-const byte SimpleKnx_::_groupAddressListSize = sizeof (_groupAddressList) / sizeof (word);
+);
 
 // program
 unsigned long blinkDelay;
@@ -84,7 +84,7 @@ void loop() {
 // ################################################
 // ### KNX EVENT CALLBACK
 // ################################################
-void telegramEventCallback(KnxTelegram telegram) {
+void telegramReceivedCallback(const KnxTelegram& telegram) {
 
     // only interessted in group events
     if (!telegram.isMulticast()) {
@@ -108,7 +108,7 @@ void telegramEventCallback(KnxTelegram telegram) {
     }
 }
 
-void telegramEventRead(KnxTelegram telegram) {
+void telegramEventRead(const KnxTelegram& telegram) {
 
     if (telegram.getTargetAddress() == G_ADDR(2,7,1)) {
         bool value = true;
@@ -158,7 +158,7 @@ void telegramEventRead(KnxTelegram telegram) {
     }
 }
 
-void telegramEventWrite(KnxTelegram telegram) {
+void telegramEventWrite(const KnxTelegram& telegram) {
 
     if (telegram.getTargetAddress() == G_ADDR(2,7,1)) {
         bool value = telegram.getBool();
@@ -33,9 +33,9 @@
 //add your function definitions for the project SimpleKnxTest here
 void setup();
 void loop();
-void telegramEventCallback(KnxTelegram telegram);
-void telegramEventRead(KnxTelegram telegram);
-void telegramEventWrite(KnxTelegram telegram);
+void telegramReceivedCallback(const KnxTelegram& telegram);
+void telegramEventRead(const KnxTelegram& telegram);
+void telegramEventWrite(const KnxTelegram& telegram);
 
 //Do not add code below this line
 #endif /* _SimpleKnxTest_H_ */
@@ -0,0 +1,62 @@
+/*
+ *    FormerDpt9.h
+ *
+ *    The DPT 9 conversions as they were before KnxDptCodec<9>, copied from
+ *    SimpleKnx_::groupWrite2ByteFloatValue and KnxTelegram::get2ByteFloatValue. The
+ *    encoder is split behind the multiplication, so it can be fed hundredths. long is
+ *    replaced by int32_t, so the host computes with the 32 bits of AVR.
+ */
+
+#ifndef FORMERDPT9_H
+#define FORMERDPT9_H
+
+#include <stdint.h>
+#include "Arduino.h"
+
+struct FormerDpt9 {
+    static void encode(float value, byte data[]) {
+        encodeCenti((int32_t)(100.0 * value), data);
+    }
+
+    // the part behind the multiplication
+    static void encodeCenti(int32_t longValuex100, byte data[]) {
+        bool negativeSign = (longValuex100 & 0x80000000) ? true : false;
+        byte exponent = 0;
+        byte round = 0;
+
+        if (negativeSign) {
+            while (longValuex100 < (int32_t)(-2048)) {
+                exponent++;
+                round = (byte)(longValuex100)&1;
+                longValuex100 >>= 1;
+                longValuex100 |= 0x80000000;
+            }
+        } else {
+            while (longValuex100 > (int32_t)(2047)) {
+                exponent++;
+                round = (byte)(longValuex100)&1;
+                longValuex100 >>= 1;
+            }
+        }
+
+        if (round) longValuex100++;
+        data[1] = (byte)longValuex100;
+        data[0] = (byte)(longValuex100 >> 8) & 0x7;
+        data[0] += exponent << 3;
+        if (negativeSign) data[0] += 0x80;
+    }
+
+    static float decode(const byte data[]) {
+        int signMultiplier = (data[0] & 0x80) ? -1 : 1;
+        word absoluteMantissa = data[1] + ((data[0] & 0x07) << 8);
+        if (signMultiplier == -1) {  // Calculate absolute mantissa value in case of negative mantissa
+            // Abs = 2's complement + 1
+            absoluteMantissa = ((~absoluteMantissa) & 0x07FF) + 1;
+        }
+        byte exponent = (data[0] & 0x78) >> 3;
+
+        return (0.01 * ((int32_t)absoluteMantissa << exponent) * signMultiplier);
+    }
+};
+
+#endif // FORMERDPT9_H
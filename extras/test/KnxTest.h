@@ -0,0 +1,48 @@
+/*
+ *    KnxTest.h
+ *
+ *    Minimal checks for the host tests, see Makefile
+ */
+
+#ifndef KNXTEST_H
+#define KNXTEST_H
+
+#include <stdio.h>
+#include <time.h>
+
+static int knxTestChecks;
+static int knxTestFailures;
+
+// CHECK(condition) counts and reports a failed condition, takes template arguments with commas
+#define CHECK(...) do { \
+        knxTestChecks++; \
+        if (!(__VA_ARGS__)) { \
+            knxTestFailures++; \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define CHECK_EQUAL(expected, actual) do { \
+        long long e_ = (long long)(expected), a_ = (long long)(actual); \
+        knxTestChecks++; \
+        if (e_ != a_) { \
+            knxTestFailures++; \
+            printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, a_, e_); \
+        } \
+    } while (0)
+
+// wall clock in nanoseconds for the benchmarks
+static inline double knxBenchNanos(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// return value of main
+static inline int knxTestResult(const char *name) {
+    printf("%s: %d checks, %d failed\n", name, knxTestChecks, knxTestFailures);
+    return (knxTestFailures == 0) ? 0 : 1;
+}
+
+#endif // KNXTEST_H
@@ -0,0 +1,68 @@
+/*
+ *    bench_address.cpp
+ *
+ *    Group address lookup time of KnxTpUart::isAddressAssigned for tables of
+ *    10 to 2000 addresses, half of the lookups hit. The table is the one of
+ *    KNX_GROUP_ADDRESSES, so its compile time check is built for 2000 addresses,
+ *    smaller tables use its beginning. The binary search takes
+ *    ceil(log2(size)) steps of a few cycles each, on AVR at 16 MHz that stays far
+ *    below the 1,7 ms ACK window even for 2000 addresses.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+// every second group address from 1/0/0 on
+#define ADDR_10(a)   (a), (a) + 2, (a) + 4, (a) + 6, (a) + 8, (a) + 10, (a) + 12, (a) + 14, (a) + 16, (a) + 18
+#define ADDR_100(a)  ADDR_10(a), ADDR_10((a) + 20), ADDR_10((a) + 40), ADDR_10((a) + 60), ADDR_10((a) + 80), \
+                     ADDR_10((a) + 100), ADDR_10((a) + 120), ADDR_10((a) + 140), ADDR_10((a) + 160), ADDR_10((a) + 180)
+#define ADDR_1000(a) ADDR_100(a), ADDR_100((a) + 200), ADDR_100((a) + 400), ADDR_100((a) + 600), ADDR_100((a) + 800), \
+                     ADDR_100((a) + 1000), ADDR_100((a) + 1200), ADDR_100((a) + 1400), ADDR_100((a) + 1600), ADDR_100((a) + 1800)
+
+KNX_GROUP_ADDRESSES(ADDR_1000(0x0800), ADDR_1000(0x0800 + 2000));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+#define LOOKUPS 1024
+#define ROUNDS  10000
+
+// the flash table of KNX_GROUP_ADDRESSES is private to SimpleKnx_, its checked copy is not
+#define TABLE      _groupAddressListCheck
+#define TABLE_SIZE (sizeof(_groupAddressListCheck) / sizeof(word))
+
+static word lookups[LOOKUPS];
+
+int main(void) {
+    static const word sizes[] = { 10, 30, 100, 255, 300, 1000, 2000 };
+    unsigned long hits = 0;
+
+    static_assert(TABLE_SIZE == 2000, "bench_address needs 2000 group addresses");
+
+    srand(1);
+
+    for (byte s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        word size = sizes[s];
+
+        // every second group address is assigned
+        for (word i = 0; i < LOOKUPS; i++) lookups[i] = 0x0800 + rand() % (2 * size);
+
+        KnxTpUart tpuart(Serial, P_ADDR(1,1,12), TABLE, size);
+
+        double start = knxBenchNanos();
+        for (int r = 0; r < ROUNDS; r++) {
+            for (word i = 0; i < LOOKUPS; i++) hits += tpuart.isAddressAssigned(lookups[i]);
+        }
+        double nanos = (knxBenchNanos() - start) / ((double)ROUNDS * LOOKUPS);
+
+        byte steps = 0;
+        while ((1u << steps) < size) steps++;
+
+        printf("%4u addresses: %2u steps, %6.2f ns per lookup\n", size, steps, nanos);
+    }
+
+    // keeps the lookups from being optimized away
+    printf("hits: %lu\n", hits);
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ *    bench_dpt9.cpp
+ *
+ *    DPT 9 conversions against the former float code of FormerDpt9.h, on all 65536 raw
+ *    values: decode to float, encode from float, and the integer hundredths of
+ *    decodeCenti and encodeCenti that skip the float multiplication.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+#include "FormerDpt9.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(1,0,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+#define ROUNDS 50
+#define VALUES 0x10000L
+
+static float values[VALUES];
+static long centis[VALUES];
+static volatile unsigned long sink;
+
+static void rawOf(long i, byte data[]) {
+    data[0] = byte(i >> 8);
+    data[1] = byte(i);
+}
+
+static double benchFormerDecode(void) {
+    float sum = 0;
+    byte data[2];
+
+    double start = knxBenchNanos();
+    for (long r = 0; r < ROUNDS; r++) {
+        for (long i = 0; i < VALUES; i++) {
+            rawOf(i, data);
+            sum += FormerDpt9::decode(data);
+        }
+    }
+    double nanos = knxBenchNanos() - start;
+
+    sink = (unsigned long)sum;
+    return nanos / ((double)ROUNDS * VALUES);
+}
+
+static double benchDecode(void) {
+    float sum = 0;
+    byte data[2];
+
+    double start = knxBenchNanos();
+    for (long r = 0; r < ROUNDS; r++) {
+        for (long i = 0; i < VALUES; i++) {
+            rawOf(i, data);
+            sum += Dpt<9, 1>::decode(data);
+        }
+    }
+    double nanos = knxBenchNanos() - start;
+
+    sink = (unsigned long)sum;
+    return nanos / ((double)ROUNDS * VALUES);
+}
+
+static double benchDecodeCenti(void) {
+    long sum = 0;
+    byte data[2];
+
+    double start = knxBenchNanos();
+    for (long r = 0; r < ROUNDS; r++) {
+        for (long i = 0; i < VALUES; i++) {
+            rawOf(i, data);
+            sum += KnxDptCodec<9>::decodeCenti(data);
+        }
+    }
+    double nanos = knxBenchNanos() - start;
+
+    sink = sum;
+    return nanos / ((double)ROUNDS * VALUES);
+}
+
+static double benchFormerEncode(void) {
+    unsigned long sum = 0;
+    byte data[2];
+
+    double start = knxBenchNanos();
+    for (long r = 0; r < ROUNDS; r++) {
+        for (long i = 0; i < VALUES; i++) {
+            FormerDpt9::encode(values[i], data);
+            sum += data[0] ^ data[1];
+        }
+    }
+    double nanos = knxBenchNanos() - start;
+
+    sink = sum;
+    return nanos / ((double)ROUNDS * VALUES);
+}
+
+static double benchEncode(void) {
+    unsigned long sum = 0;
+    byte data[2];
+
+    double start = knxBenchNanos();
+    for (long r = 0; r < ROUNDS; r++) {
+        for (long i = 0; i < VALUES; i++) {
+            Dpt<9, 1>::encode(values[i], data);
+            sum += data[0] ^ data[1];
+        }
+    }
+    double nanos = knxBenchNanos() - start;
+
+    sink = sum;
+    return nanos / ((double)ROUNDS * VALUES);
+}
+
+static double benchEncodeCenti(void) {
+    unsigned long sum = 0;
+    byte data[2];
+
+    double start = knxBenchNanos();
+    for (long r = 0; r < ROUNDS; r++) {
+        for (long i = 0; i < VALUES; i++) {
+            KnxDptCodec<9>::encodeCenti(centis[i], data);
+            sum += data[0] ^ data[1];
+        }
+    }
+    double nanos = knxBenchNanos() - start;
+
+    sink = sum;
+    return nanos / ((double)ROUNDS * VALUES);
+}
+
+int main(void) {
+    byte data[2];
+
+    for (long i = 0; i < VALUES; i++) {
+        rawOf(i, data);
+        values[i] = FormerDpt9::decode(data);
+        centis[i] = KnxDptCodec<9>::decodeCenti(data);
+    }
+
+    printf("decode: former %6.2f ns, float %6.2f ns, centi %6.2f ns per value\n", benchFormerDecode(), benchDecode(), benchDecodeCenti());
+    printf("encode: former %6.2f ns, float %6.2f ns, centi %6.2f ns per value\n", benchFormerEncode(), benchEncode(), benchEncodeCenti());
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ *    bench_ringbuff.cpp
+ *
+ *    RingBuff against the former implementation, copied below, on the way the receive
+ *    queue uses it: a telegram is filled byte by byte, queued, and read by the application.
+ *    The former one fills a local telegram and copies it in and out, the current one
+ *    fills the tail slot in place and reads the head in place. Sizes 8 (power of two,
+ *    masked indices) and 10 (compared indices).
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+#include "RingBuff.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(1,0,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+// RingBuff as it was before items could be filled in place
+template<typename T, uint16_t size>
+class FormerRingBuff {
+    byte _head;
+    byte _tail;
+    T _buffer[size]; // item buffer
+    byte _size;
+    byte _itemCount;
+
+public:
+
+    FormerRingBuff() {
+        _head = 0;
+        _tail = 0;
+        _itemCount = 0;
+        _size = size;
+    };
+
+    void append(const T& data) {
+        if (_itemCount == _size) { // buffer full, overwriting oldest data
+            incHead();
+        } else {
+            _itemCount++;
+        }
+        _buffer[_tail] = data;
+        incTail();
+    }
+
+    boolean pop(T& data) {
+        if (_itemCount==0) return false;
+        data = _buffer[_head];
+        incHead();
+        _itemCount--;
+        return true;
+    }
+
+    byte getItemCount(void) const {
+        return _itemCount;
+    }
+
+private:
+
+    void incHead(void) {
+        _head = (_head + 1) % _size;
+    }
+
+    void incTail(void) {
+        _tail = (_tail + 1) % _size;
+    }
+};
+
+#define ROUNDS 2000000
+#define BURST  4
+
+static byte frame[KNX_TELEGRAM_MAX_SIZE];
+static byte frameLength;
+static volatile unsigned long sink;
+
+template<uint16_t size>
+static double benchFormer(void) {
+    static FormerRingBuff<KnxTelegram, size> queue;
+    KnxTelegram received, handled;
+    unsigned long sum = 0;
+
+    double start = knxBenchNanos();
+    for (long r = 0; r < ROUNDS; r++) {
+        for (byte b = 0; b < BURST; b++) {
+            for (byte i = 0; i < frameLength; i++) received.setRawByte(frame[i] + b, i);
+            queue.append(received);
+        }
+        while (queue.pop(handled)) sum += handled.getTargetAddress();
+    }
+    double nanos = knxBenchNanos() - start;
+
+    sink = sum;
+    return nanos / ((double)ROUNDS * BURST);
+}
+
+template<uint16_t size>
+static double benchInPlace(void) {
+    static RingBuff<KnxTelegram, size> queue;
+    unsigned long sum = 0;
+
+    double start = knxBenchNanos();
+    for (long r = 0; r < ROUNDS; r++) {
+        for (byte b = 0; b < BURST; b++) {
+            KnxTelegram *received = queue.reserve();
+            for (byte i = 0; i < frameLength; i++) received->setRawByte(frame[i] + b, i);
+            queue.commit();
+        }
+        for (const KnxTelegram *handled = queue.peek(); handled != NULL; handled = queue.peek()) {
+            sum += handled->getTargetAddress();
+            queue.drop();
+        }
+    }
+    double nanos = knxBenchNanos() - start;
+
+    sink = sum;
+    return nanos / ((double)ROUNDS * BURST);
+}
+
+int main(void) {
+    KnxTelegram t;
+    byte value = 1;
+
+    t.setSourceAddress(P_ADDR(1,1,5));
+    t.setTargetAddress(G_ADDR(2,7,1));
+    t.setCommand(KNX_COMMAND_VALUE_WRITE);
+    t.setPayload(&value, 1);
+    frameLength = t.getTelegramLength();
+    for (byte i = 0; i < frameLength; i++) frame[i] = t.getRawByte(i);
+
+    printf("size  8: former %6.2f ns, in place %6.2f ns per telegram\n", benchFormer<8>(), benchInPlace<8>());
+    printf("size 10: former %6.2f ns, in place %6.2f ns per telegram\n", benchFormer<10>(), benchInPlace<10>());
+    printf("%u bytes copied twice per telegram by the former one\n", (unsigned)sizeof(KnxTelegram));
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ *    bench_rx_burst.cpp
+ *
+ *    Reception throughput of KnxTpUart::rxTask on a recorded byte stream: bus
+ *    traffic of telegrams with 1 to 4 byte payloads, a quarter of them addressed
+ *    to the device. The stream is fed in bursts of whole telegrams, as a slow main
+ *    loop sees them, and byte by byte, as a fast one does. Reports the bytes per
+ *    second of host time spent in the library and the mock serial.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(1,0,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+#define STREAM_TELEGRAMS 200
+#define ROUNDS 200
+
+static const word groupAddresses[] = { G_ADDR(2,7,1), G_ADDR(2,7,2), G_ADDR(2,7,3), G_ADDR(2,7,4) };
+
+static byte stream[STREAM_TELEGRAMS * KNX_TELEGRAM_MAX_SIZE];
+static byte frameLength[STREAM_TELEGRAMS];
+static unsigned long streamBytes;
+static KnxTpUart *tpuart;
+static unsigned long received;
+
+static void events(KnxTpUartEvent) {}
+
+static void record(void) {
+    byte *raw = stream;
+
+    srand(1);
+
+    for (int i = 0; i < STREAM_TELEGRAMS; i++) {
+        KnxTelegram t;
+        byte payload[4] = { (byte)i, 1, 2, 3 };
+        boolean addressed = (rand() % 4) == 0;
+
+        t.setSourceAddress(P_ADDR(1,1,(byte)(rand() % 200 + 1)));
+        t.setTargetAddress(addressed ? groupAddresses[rand() % 4] : G_ADDR(3, rand() % 8, rand() % 256));
+        t.setCommand(KNX_COMMAND_VALUE_WRITE);
+        t.setPayload(payload, 1 + rand() % 4);
+        t.updateChecksum();
+
+        frameLength[i] = t.getTelegramLength();
+        for (byte j = 0; j < frameLength[i]; j++) *raw++ = t.getRawByte(j);
+        streamBytes += frameLength[i];
+    }
+}
+
+static void start(void) {
+    mockReset();
+    mockMicrosPerCall = 1;
+    delete tpuart;
+    tpuart = new KnxTpUart(Serial, P_ADDR(1,1,12), groupAddresses, 4);
+    tpuart->reset();
+    tpuart->setEvtCallback(events);
+    tpuart->init();
+}
+
+static void drain(void) {
+    while (tpuart->peekReceivedTelegram() != NULL) {
+        received++;
+        tpuart->popReceivedTelegram();
+    }
+}
+
+// every telegram arrives at once and is processed by one rxTask call
+static void feedBursts(void) {
+    const byte *raw = stream;
+
+    for (int i = 0; i < STREAM_TELEGRAMS; i++) {
+        unsigned long t = mockNow() + 10;
+
+        for (byte j = 0; j < frameLength[i]; j++) mockRxByte(*raw++, t);
+        mockAdvanceTo(t);
+        tpuart->rxTask();
+
+        // silence ends the telegram
+        mockAdvance(3 * MOCK_BUS_CHARACTER_TIME);
+        tpuart->rxTask();
+        drain();
+    }
+}
+
+// one rxTask call per byte, as with the former byte wise reception
+static void feedBytes(void) {
+    const byte *raw = stream;
+
+    for (int i = 0; i < STREAM_TELEGRAMS; i++) {
+        for (byte j = 0; j < frameLength[i]; j++) {
+            unsigned long t = mockNow() + 10;
+
+            mockRxByte(*raw++, t);
+            mockAdvanceTo(t);
+            tpuart->rxTask();
+        }
+
+        mockAdvance(3 * MOCK_BUS_CHARACTER_TIME);
+        tpuart->rxTask();
+        drain();
+    }
+}
+
+static void run(const char *name, void (*feed)(void)) {
+    double nanos = 0;
+
+    received = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        start();
+        double begin = knxBenchNanos();
+        feed();
+        nanos += knxBenchNanos() - begin;
+    }
+
+    printf("%-8s %10.0f bytes/s, %lu of %d telegrams received\n", name,
+           streamBytes * ROUNDS / (nanos / 1e9), received / ROUNDS, STREAM_TELEGRAMS);
+}
+
+int main(void) {
+    record();
+
+    run("bursts", feedBursts);
+    run("bytes", feedBytes);
+
+    delete tpuart;
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+/*
+ *    HardwareSerial.h
+ *
+ *    Host mock of the serial port, wired to the simulated TPUART of MockArduino.cpp
+ */
+
+#ifndef MOCK_HARDWARESERIAL_H
+#define MOCK_HARDWARESERIAL_H
+
+#include "Arduino.h"
+
+class HardwareSerial : public Stream {
+  public:
+    void begin(unsigned long baud, uint8_t config = 0);
+    void end(void);
+    int available(void);
+    int read(void);
+    int peek(void);
+    int availableForWrite(void);
+    void flush(void);
+    size_t write(uint8_t data);
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif // MOCK_HARDWARESERIAL_H
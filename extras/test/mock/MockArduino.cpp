@@ -0,0 +1,310 @@
+/*
+ *    MockArduino.cpp
+ *
+ *    Host mock of the Arduino core and a TPUART, see MockArduino.h
+ */
+
+#include "MockArduino.h"
+
+#define TPUART_RESET_ANSWER_TIME 500 // us
+
+typedef struct MockRxByte {
+    byte data;
+    unsigned long time;
+} MockRxByte;
+
+unsigned long mockMicrosPerCall = 4;
+unsigned long mockMillisOffset;
+MockTxByte mockTxLog[MOCK_LOG_SIZE];
+int mockTxCount;
+MockFrame mockFrames[64];
+int mockFrameCount;
+MockAck mockAcks[MOCK_LOG_SIZE];
+int mockAckCount;
+boolean mockBusmonActive;
+
+HardwareSerial Serial;
+
+static unsigned long now = 1000;
+static boolean updating;
+static void (*rxIsr)(void);
+
+// line from the TPUART, sorted by time, and the serial receive buffer
+static MockRxByte line[MOCK_LOG_SIZE];
+static int lineHead, lineTail;
+static byte rxBuffer[MOCK_SERIAL_RX_BUFFER];
+static int rxHead, rxCount, rxLost;
+
+// serial transmit buffer and the byte being shifted out
+static byte txBuffer[256];
+static unsigned long txWriteTime[256];
+static int txHead, txCount, txBufferSize;
+static boolean txShifting;
+static MockTxByte txShift;
+static unsigned long txBlocked;
+
+// TPUART receiving from the serial
+static const byte *confirms;
+static int confirmCount, confirmIndex;
+static boolean tpuartData, tpuartLast;
+static byte tpuartIndex;
+static MockFrame tpuartFrame;
+
+static void update(void);
+
+void mockReset(void) {
+    mockMicrosPerCall = 4;
+    rxIsr = NULL;
+    lineHead = lineTail = 0;
+    rxHead = rxCount = rxLost = 0;
+    txHead = txCount = 0;
+    txBufferSize = 64;
+    txShifting = false;
+    txBlocked = 0;
+    mockTxCount = 0;
+    mockFrameCount = 0;
+    mockAckCount = 0;
+    mockBusmonActive = false;
+    confirms = NULL;
+    confirmCount = confirmIndex = 0;
+    tpuartData = false;
+    tpuartFrame.length = 0;
+}
+
+unsigned long mockNow(void) {
+    return now;
+}
+
+void mockAdvance(unsigned long microsec) {
+    mockAdvanceTo(now + microsec);
+}
+
+// steps through all events on the way, so the interrupt sees every byte in time
+void mockAdvanceTo(unsigned long timeMicrosec) {
+    while (now < timeMicrosec) {
+        unsigned long next = timeMicrosec;
+
+        if ((lineHead < lineTail) && (line[lineHead].time > now) && (line[lineHead].time < next)) next = line[lineHead].time;
+        if (txShifting && (txShift.sentTime > now) && (txShift.sentTime < next)) next = txShift.sentTime;
+
+        now = next;
+        update();
+    }
+}
+
+void mockSetRxInterrupt(void (*isr)(void)) {
+    rxIsr = isr;
+}
+
+void mockRxByte(byte data, unsigned long timeMicrosec) {
+    int i = lineTail++;
+
+    // keep the line sorted, TPUART answers may be queued in between
+    while ((i > lineHead) && (line[i - 1].time > timeMicrosec)) {
+        line[i] = line[i - 1];
+        i--;
+    }
+    line[i].data = data;
+    line[i].time = timeMicrosec;
+}
+
+unsigned long mockRxFrame(const byte data[], byte length, unsigned long timeMicrosec) {
+    for (byte i = 0; i < length; i++) {
+        mockRxByte(data[i], timeMicrosec + i * MOCK_BUS_CHARACTER_TIME);
+    }
+
+    return timeMicrosec + (length - 1) * MOCK_BUS_CHARACTER_TIME;
+}
+
+int mockRxPending(void) {
+    return (lineTail - lineHead) + rxCount;
+}
+
+int mockRxLostCount(void) {
+    return rxLost;
+}
+
+void mockSetTxBufferSize(int size) {
+    txBufferSize = size;
+}
+
+unsigned long mockTxBlockedTime(void) {
+    return txBlocked;
+}
+
+void mockSetConfirms(const byte list[], int count) {
+    confirms = list;
+    confirmCount = count;
+    confirmIndex = 0;
+}
+
+// the TPUART got a byte from the serial
+static void tpuartReceive(byte data, unsigned long time) {
+    if (tpuartData) {
+        tpuartData = false;
+        tpuartFrame.data[tpuartIndex] = data;
+        if (tpuartIndex >= tpuartFrame.length) tpuartFrame.length = tpuartIndex + 1;
+        if (!tpuartLast) return;
+
+        // the frame goes over the bus, then it is confirmed
+        tpuartFrame.endTime = time;
+        if (mockFrameCount < 64) mockFrames[mockFrameCount++] = tpuartFrame;
+
+        byte confirm = (confirmIndex < confirmCount) ? confirms[confirmIndex++] : 0x8B;
+        if (confirm) mockRxByte(confirm, time + (tpuartFrame.length + 3) * MOCK_BUS_CHARACTER_TIME);
+        tpuartFrame.length = 0;
+        return;
+    }
+
+    switch (data & 0xC0) {
+        case 0x80: // data start / continue
+        case 0x40: // data end
+            tpuartData = true;
+            tpuartLast = ((data & 0xC0) == 0x40);
+            tpuartIndex = data & 0x3F;
+            return;
+    }
+
+    switch (data) {
+        case 0x01: // reset request
+            mockBusmonActive = false;
+            tpuartFrame.length = 0;
+            mockRxByte(0x03, time + TPUART_RESET_ANSWER_TIME);
+            break;
+
+        case 0x02: // state request
+            mockRxByte(0x07, time + MOCK_SERIAL_BYTE_TIME);
+            break;
+
+        case 0x05: // bus monitor
+            mockBusmonActive = true;
+            break;
+
+        case 0x10: // ACK services
+        case 0x11:
+        case 0x13:
+            if (mockAckCount < MOCK_LOG_SIZE) {
+                mockAcks[mockAckCount].service = data;
+                mockAcks[mockAckCount].time = time;
+                mockAckCount++;
+            }
+            break;
+    }
+}
+
+static void txStart(byte data, unsigned long writeTime, unsigned long startTime) {
+    txShifting = true;
+    txShift.data = data;
+    txShift.writeTime = writeTime;
+    txShift.sentTime = startTime + MOCK_SERIAL_BYTE_TIME;
+}
+
+// moves the simulation up to now
+static void update(void) {
+    if (updating) return;
+    updating = true;
+
+    while (txShifting && (txShift.sentTime <= now)) {
+        if (mockTxCount < MOCK_LOG_SIZE) mockTxLog[mockTxCount++] = txShift;
+        tpuartReceive(txShift.data, txShift.sentTime);
+        txShifting = false;
+
+        if (txCount > 0) {
+            txStart(txBuffer[txHead], txWriteTime[txHead], txShift.sentTime);
+            txHead = (txHead + 1) % 256;
+            txCount--;
+        }
+    }
+
+    while ((lineHead < lineTail) && (line[lineHead].time <= now)) {
+        if (rxCount < MOCK_SERIAL_RX_BUFFER) {
+            rxBuffer[(rxHead + rxCount) % MOCK_SERIAL_RX_BUFFER] = line[lineHead].data;
+            rxCount++;
+        } else {
+            rxLost++;
+        }
+
+        // the interrupt runs at the arrival time of the byte
+        if (rxIsr != NULL) {
+            unsigned long saved = now;
+            now = line[lineHead].time;
+            rxIsr();
+            now = saved;
+        }
+        lineHead++;
+    }
+    if (lineHead == lineTail) lineHead = lineTail = 0;
+
+    updating = false;
+}
+
+unsigned long micros(void) {
+    if (!updating) {
+        now += mockMicrosPerCall;
+        update();
+    }
+    return now;
+}
+
+unsigned long millis(void) {
+    return micros() / 1000 + mockMillisOffset;
+}
+
+void delay(unsigned long ms) {
+    mockAdvance(ms * 1000);
+}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+
+void HardwareSerial::begin(unsigned long, uint8_t) {}
+void HardwareSerial::end(void) {}
+void HardwareSerial::flush(void) {}
+
+int HardwareSerial::available(void) {
+    update();
+    return rxCount;
+}
+
+int HardwareSerial::read(void) {
+    update();
+    if (rxCount == 0) return -1;
+
+    byte data = rxBuffer[rxHead];
+    rxHead = (rxHead + 1) % MOCK_SERIAL_RX_BUFFER;
+    rxCount--;
+
+    return data;
+}
+
+int HardwareSerial::peek(void) {
+    update();
+    return (rxCount == 0) ? -1 : rxBuffer[rxHead];
+}
+
+int HardwareSerial::availableForWrite(void) {
+    update();
+    return txBufferSize - 1 - txCount;
+}
+
+// blocks while the buffer is full, as HardwareSerial does
+size_t HardwareSerial::write(uint8_t data) {
+    update();
+
+    if (!txShifting) {
+        txStart(data, now, now);
+        return 1;
+    }
+
+    while (txCount >= txBufferSize - 1) {
+        unsigned long start = now;
+        mockAdvanceTo(txShift.sentTime);
+        txBlocked += now - start;
+    }
+
+    txBuffer[(txHead + txCount) % 256] = data;
+    txWriteTime[(txHead + txCount) % 256] = now;
+    txCount++;
+
+    return 1;
+}
@@ -0,0 +1,79 @@
+/*
+ *    MockArduino.h
+ *
+ *    Control of the host mock: a simulated clock, the serial port of the Arduino
+ *    and a TPUART behind it.
+ *
+ *    Time only passes when the library asks for it, every micros() or millis() call
+ *    takes mockMicrosPerCall, and when a test calls mockAdvance. The serial sends one
+ *    byte every MOCK_SERIAL_BYTE_TIME from a buffer of mockSetTxBufferSize bytes and
+ *    blocks like HardwareSerial when it is full. Received bytes wait in a 64 byte
+ *    buffer, bytes arriving while it is full are lost.
+ *
+ *    The TPUART answers reset and state requests, logs ACK services and data frames
+ *    and confirms every data frame once it went over the bus, see mockSetConfirms.
+ */
+
+#ifndef MOCK_MOCKARDUINO_H
+#define MOCK_MOCKARDUINO_H
+
+#include "Arduino.h"
+
+#define MOCK_SERIAL_BYTE_TIME   573 // us, 11 bits at 19200 baud
+#define MOCK_SERIAL_RX_BUFFER    64
+#define MOCK_BUS_CHARACTER_TIME 1354 // us, 13 bits at 9600 baud
+#define MOCK_LOG_SIZE          2048
+
+typedef struct MockTxByte {
+    byte data;
+    unsigned long writeTime;         // written to the serial
+    unsigned long sentTime;          // completely sent to the TPUART
+} MockTxByte;
+
+typedef struct MockFrame {
+    byte data[64];
+    byte length;
+    unsigned long endTime;           // last byte received by the TPUART
+} MockFrame;
+
+typedef struct MockAck {
+    byte service;                    // TPUART_RX_ACK_SERVICE_xxx
+    unsigned long time;              // received by the TPUART
+} MockAck;
+
+// starts over with empty buffers and logs. Time keeps running, it never goes back on the device either.
+void mockReset(void);
+
+// simulated time
+extern unsigned long mockMicrosPerCall;
+unsigned long mockNow(void);
+void mockAdvance(unsigned long microsec);
+void mockAdvanceTo(unsigned long timeMicrosec);
+extern unsigned long mockMillisOffset; // added to millis(), so it can be run across its wraparound
+
+// called for every byte received by the serial, at its arrival time, like the UART RX interrupt
+void mockSetRxInterrupt(void (*isr)(void));
+
+// bytes sent by the bus to the serial, a frame at bus speed starting at the time given.
+// Returns the arrival time of the last byte.
+void mockRxByte(byte data, unsigned long timeMicrosec);
+unsigned long mockRxFrame(const byte data[], byte length, unsigned long timeMicrosec);
+int mockRxPending(void);             // bytes still on the line or in the serial buffer
+int mockRxLostCount(void);           // bytes lost as the serial buffer was full
+
+// serial transmit side
+void mockSetTxBufferSize(int size);  // like SERIAL_TX_BUFFER_SIZE, 64 by default
+unsigned long mockTxBlockedTime(void); // time spent blocking in write
+extern MockTxByte mockTxLog[MOCK_LOG_SIZE];
+extern int mockTxCount;
+
+// TPUART: answers to the next data frames, TPUART_DATA_CONFIRM_xxx or 0 for none.
+// Frames beyond the list are confirmed with success.
+void mockSetConfirms(const byte confirms[], int count);
+extern MockFrame mockFrames[64];
+extern int mockFrameCount;
+extern MockAck mockAcks[MOCK_LOG_SIZE];
+extern int mockAckCount;
+extern boolean mockBusmonActive;
+
+#endif // MOCK_MOCKARDUINO_H
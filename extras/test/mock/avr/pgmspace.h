@@ -0,0 +1,20 @@
+/*
+ *    avr/pgmspace.h
+ *
+ *    Host mock, flash is ordinary memory
+ */
+
+#ifndef MOCK_PGMSPACE_H
+#define MOCK_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define memcpy_P memcpy
+
+#endif // MOCK_PGMSPACE_H
@@ -0,0 +1,10 @@
+/*
+ *    avr/wdt.h
+ *
+ *    Host mock, there is no watchdog
+ */
+
+#ifndef MOCK_WDT_H
+#define MOCK_WDT_H
+
+#endif // MOCK_WDT_H
@@ -0,0 +1,252 @@
+/*
+ *    test_batch.cpp
+ *
+ *    Transmit batches: room reserved by beginBatch for the worst case of its members,
+ *    members popped back to back once started, committed members not evicted by a full
+ *    queue, and group writes made from within task() kept out of an open batch.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+typedef KnxTxQueue<KnxTxEntry, ACTIONS_QUEUE_SIZE, ACTIONS_QUEUE_ARENA_SIZE> Queue;
+
+#define DPT9_STORED_SIZE (KNX_TX_ENTRY_STORED_OVERHEAD + 3)
+
+#define CYCLIC_GROUP G_ADDR(4,0,1)
+
+static int cyclicConfirmed;
+static int batchDropped;
+
+void cyclicSendCallback(word groupAddress) {
+    SimpleKnx.groupWriteBool(false, groupAddress, true);
+}
+
+void telegramCompletedCallback(const KnxTxCompletion& completion) {
+    if ((completion.groupAddress == CYCLIC_GROUP) && (completion.status == KNX_TX_CONFIRMED)) cyclicConfirmed++;
+    if ((completion.groupAddress != CYCLIC_GROUP) && (completion.status == KNX_TX_DROPPED)) batchDropped++;
+}
+
+#define NO_ADDRESS 0 // not used by any telegram here
+
+// allows all target addresses but one
+struct Limiter {
+    word blocked;
+    boolean isAllowed(word targetAddress) const { return targetAddress != blocked; }
+};
+
+static void makeEntry(KnxTxEntry& entry, word groupAddress, byte length, KnxPriority priority) {
+    byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE] = { 0 };
+
+    entry.telegram.clearTelegram();
+    entry.telegram.setPriority(priority);
+    entry.telegram.setTargetAddress(groupAddress);
+    entry.telegram.setCommand(KNX_COMMAND_VALUE_WRITE);
+    entry.telegram.setPayload(payload, length);
+    entry.handle = 1;
+    entry.enqueueTimeMicrosec = micros();
+}
+
+static void run(unsigned long microsec) {
+    unsigned long end = mockNow() + microsec;
+
+    while (mockNow() < end) {
+        mockAdvance(200);
+        SimpleKnx.task();
+    }
+}
+
+// beginBatch checks the bytes of count members, and other telegrams cannot take them
+static void testReservation(void) {
+    static Queue queue;
+    KnxTxEntry entry;
+    int others = 0;
+
+    CHECK(!queue.beginBatch(30, DPT9_STORED_SIZE, KNX_PRIORITY_NORMAL_VALUE));
+    CHECK(!queue.beginBatch(ACTIONS_QUEUE_SIZE + 1, 1, KNX_PRIORITY_NORMAL_VALUE));
+    CHECK(queue.beginBatch(20, DPT9_STORED_SIZE, KNX_PRIORITY_NORMAL_VALUE));
+    CHECK(queue.isBatchOpen());
+
+    // other telegrams fill the rest of the queue, with any policy
+    queue.setPolicy(KNX_TX_QUEUE_OVERWRITE);
+    for (word i = 0; i < 100; i++) {
+        makeEntry(entry, G_ADDR(3, 0, i), 2, KNX_PRIORITY_NORMAL_VALUE);
+        if (queue.append(entry) != KNX_TX_QUEUE_REJECTED) others++;
+    }
+    CHECK(others > 0);
+    CHECK_EQUAL((ACTIONS_QUEUE_ARENA_SIZE - 20 * DPT9_STORED_SIZE) / DPT9_STORED_SIZE, queue.getItemCount());
+
+    for (word i = 0; i < 20; i++) {
+        makeEntry(entry, G_ADDR(1, 0, i), 2, KNX_PRIORITY_NORMAL_VALUE);
+        CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, queue.appendToBatch(entry));
+    }
+    CHECK(queue.commitBatch());
+    CHECK(!queue.isBatchOpen());
+
+    // a member larger than reserved fails the batch
+    while (queue.pop(entry)) {}
+    CHECK(queue.beginBatch(2, DPT9_STORED_SIZE, KNX_PRIORITY_NORMAL_VALUE));
+    makeEntry(entry, G_ADDR(1, 0, 1), 4, KNX_PRIORITY_NORMAL_VALUE);
+    CHECK_EQUAL(KNX_TX_QUEUE_REJECTED, queue.appendToBatch(entry));
+    CHECK(!queue.commitBatch());
+    while (queue.popBatch(entry)) {}
+    CHECK(!queue.isBatchOpen());
+}
+
+// once the first member is popped, the others follow before any other telegram
+static void testContiguous(void) {
+    static Queue queue;
+    KnxTxEntry entry;
+    Limiter limiter = { NO_ADDRESS };
+
+    makeEntry(entry, G_ADDR(3, 0, 1), 0, KNX_PRIORITY_NORMAL_VALUE);
+    queue.append(entry);
+
+    CHECK(queue.beginBatch(3, DPT9_STORED_SIZE, KNX_PRIORITY_NORMAL_VALUE));
+    for (word i = 0; i < 3; i++) {
+        makeEntry(entry, G_ADDR(1, 0, i), 2, KNX_PRIORITY_NORMAL_VALUE);
+        queue.appendToBatch(entry);
+    }
+    CHECK(queue.commitBatch());
+
+    // the rate limiter skips the telegram in front, the batch starts
+    limiter.blocked = G_ADDR(3, 0, 1);
+    CHECK(queue.pop(entry, limiter));
+    CHECK_EQUAL(G_ADDR(1, 0, 0), entry.getTargetAddress());
+    CHECK(queue.isBatchRunning());
+
+    // an alarm and the skipped telegram wait behind the members
+    makeEntry(entry, G_ADDR(5, 0, 1), 0, KNX_PRIORITY_ALARM_VALUE);
+    queue.append(entry);
+    limiter.blocked = NO_ADDRESS;
+    CHECK(queue.pop(entry, limiter));
+    CHECK_EQUAL(G_ADDR(1, 0, 1), entry.getTargetAddress());
+
+    // a rate limited member holds back everything
+    limiter.blocked = G_ADDR(1, 0, 2);
+    CHECK(!queue.pop(entry, limiter));
+    limiter.blocked = NO_ADDRESS;
+    CHECK(queue.pop(entry));
+    CHECK_EQUAL(G_ADDR(1, 0, 2), entry.getTargetAddress());
+    CHECK(!queue.isBatchRunning());
+
+    CHECK(queue.pop(entry, limiter));
+    CHECK_EQUAL(G_ADDR(5, 0, 1), entry.getTargetAddress());
+    CHECK(queue.pop(entry, limiter));
+    CHECK_EQUAL(G_ADDR(3, 0, 1), entry.getTargetAddress());
+
+    // a batch with a member the limiter holds back is not started
+    CHECK(queue.beginBatch(2, DPT9_STORED_SIZE, KNX_PRIORITY_NORMAL_VALUE));
+    makeEntry(entry, G_ADDR(1, 0, 0), 2, KNX_PRIORITY_NORMAL_VALUE);
+    queue.appendToBatch(entry);
+    makeEntry(entry, G_ADDR(1, 0, 1), 2, KNX_PRIORITY_NORMAL_VALUE);
+    queue.appendToBatch(entry);
+    CHECK(queue.commitBatch());
+    makeEntry(entry, G_ADDR(3, 0, 2), 0, KNX_PRIORITY_NORMAL_VALUE);
+    queue.append(entry);
+
+    limiter.blocked = G_ADDR(1, 0, 1);
+    CHECK(queue.pop(entry, limiter));
+    CHECK_EQUAL(G_ADDR(3, 0, 2), entry.getTargetAddress());
+    CHECK(!queue.isBatchRunning());
+    CHECK(!queue.pop(entry, limiter));
+}
+
+// an alarm appended to a full queue evicts the telegram besides a committed batch, never a member
+static void testEviction(void) {
+    static KnxTxQueue<KnxTxEntry, 4, 100> queue;
+    KnxTxEntry entry, dropped;
+
+    CHECK(queue.beginBatch(3, DPT9_STORED_SIZE, KNX_PRIORITY_NORMAL_VALUE));
+    for (word i = 0; i < 3; i++) {
+        makeEntry(entry, G_ADDR(1, 0, i), 2, KNX_PRIORITY_NORMAL_VALUE);
+        queue.appendToBatch(entry);
+    }
+    CHECK(queue.commitBatch());
+    makeEntry(entry, G_ADDR(3, 0, 1), 0, KNX_PRIORITY_NORMAL_VALUE);
+    CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, queue.append(entry));
+
+    makeEntry(entry, G_ADDR(5, 0, 1), 0, KNX_PRIORITY_ALARM_VALUE);
+    CHECK_EQUAL(KNX_TX_QUEUE_REPLACED, queue.append(entry, &dropped));
+    CHECK_EQUAL(G_ADDR(3, 0, 1), dropped.getTargetAddress());
+
+    // only members are left to drop
+    makeEntry(entry, G_ADDR(5, 0, 2), 0, KNX_PRIORITY_ALARM_VALUE);
+    CHECK_EQUAL(KNX_TX_QUEUE_REJECTED, queue.append(entry));
+    queue.setPolicy(KNX_TX_QUEUE_OVERWRITE);
+    makeEntry(entry, G_ADDR(3, 0, 2), 0, KNX_PRIORITY_NORMAL_VALUE);
+    CHECK_EQUAL(KNX_TX_QUEUE_REJECTED, queue.append(entry));
+
+    CHECK(queue.pop(entry));
+    CHECK_EQUAL(G_ADDR(5, 0, 1), entry.getTargetAddress());
+    CHECK(!queue.isBatchRunning());
+    for (word i = 0; i < 3; i++) {
+        CHECK(queue.pop(entry));
+        CHECK_EQUAL(G_ADDR(1, 0, i), entry.getTargetAddress());
+    }
+    CHECK(!queue.pop(entry));
+
+    // neither the first member nor the next one of a running batch is dropped
+    queue.setPolicy(KNX_TX_QUEUE_EVICT);
+    CHECK(queue.beginBatch(3, DPT9_STORED_SIZE, KNX_PRIORITY_NORMAL_VALUE));
+    for (word i = 0; i < 3; i++) {
+        makeEntry(entry, G_ADDR(1, 0, i), 2, KNX_PRIORITY_NORMAL_VALUE);
+        queue.appendToBatch(entry);
+    }
+    CHECK(queue.commitBatch());
+    CHECK(queue.pop(entry));
+    CHECK(queue.isBatchRunning());
+    makeEntry(entry, G_ADDR(5, 0, 1), 0, KNX_PRIORITY_ALARM_VALUE);
+    CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, queue.append(entry));
+    makeEntry(entry, G_ADDR(5, 0, 2), 0, KNX_PRIORITY_ALARM_VALUE);
+    CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, queue.append(entry));
+    makeEntry(entry, G_ADDR(5, 0, 3), 0, KNX_PRIORITY_ALARM_VALUE);
+    CHECK_EQUAL(KNX_TX_QUEUE_REJECTED, queue.append(entry));
+    CHECK(queue.pop(entry));
+    CHECK_EQUAL(G_ADDR(1, 0, 1), entry.getTargetAddress());
+    CHECK(queue.pop(entry));
+    CHECK_EQUAL(G_ADDR(1, 0, 2), entry.getTargetAddress());
+}
+
+// cyclic values written by task while a batch is open are sent at their own priority,
+// and survive aborting the batch
+static void testTaskWrites(void) {
+    mockReset();
+    SimpleKnx.init(Serial, P_ADDR(1,1,12));
+    CHECK(SimpleKnx.setCyclicSend(CYCLIC_GROUP, 300));
+
+    CHECK(SimpleKnx.beginTxBatch(2, KNX_PRIORITY_ALARM_VALUE, Dpt<9, 1>::size));
+    CHECK(SimpleKnx.groupWrite2ByteFixedValue(false, G_ADDR(1, 0, 1), 2150) == KNX_TX_QUEUE_APPENDED);
+
+    run(1000000);
+    CHECK(cyclicConfirmed >= 2);
+    CHECK(mockFrameCount >= 2);
+    CHECK_EQUAL(KNX_PRIORITY_NORMAL_VALUE, mockFrames[0].data[0] & CONTROL_FIELD_PRIORITY_MASK);
+    CHECK_EQUAL(CYCLIC_GROUP, (mockFrames[0].data[3] << 8) | mockFrames[0].data[4]);
+
+    // the batch has room for one more member only
+    CHECK(SimpleKnx.groupWrite2ByteFixedValue(false, G_ADDR(1, 0, 2), 2150) == KNX_TX_QUEUE_APPENDED);
+    CHECK(SimpleKnx.groupWrite2ByteFixedValue(false, G_ADDR(1, 0, 3), 2150) == KNX_TX_QUEUE_REJECTED);
+    SimpleKnx.abortTxBatch();
+    CHECK_EQUAL(2, batchDropped);
+    CHECK(!SimpleKnx.commitTxBatch());
+
+    run(1000000);
+    for (int i = 0; i < mockFrameCount; i++) CHECK_EQUAL(CYCLIC_GROUP, (mockFrames[i].data[3] << 8) | mockFrames[i].data[4]);
+}
+
+int main(void) {
+    mockReset();
+
+    testReservation();
+    testContiguous();
+    testEviction();
+    testTaskWrites();
+
+    return knxTestResult("test_batch");
+}
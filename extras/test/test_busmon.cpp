@@ -0,0 +1,104 @@
+/*
+ *    test_busmon.cpp
+ *
+ *    Bus monitor mode of KnxTpUart: captured records, and a reset of the TPUART
+ *    ending the capture.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+static const word groupAddresses[] = { G_ADDR(2,7,1) };
+static KnxTpUart *tpuart;
+static int resets;
+
+static void events(KnxTpUartEvent event) {
+    if (event == TPUART_EVENT_RESET) resets++;
+}
+
+static void runUntil(unsigned long timeMicrosec) {
+    while (mockNow() < timeMicrosec) {
+        mockAdvance(100);
+        tpuart->rxTask();
+    }
+}
+
+static void startBusmon(void) {
+    mockReset();
+    delete tpuart;
+    tpuart = new KnxTpUart(Serial, P_ADDR(1,1,12), groupAddresses, 1);
+    resets = 0;
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->reset());
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->setEvtCallback(events));
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->init());
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->activateBusmon());
+    runUntil(mockNow() + 1000);
+    CHECK(mockBusmonActive);
+}
+
+// a telegram and its ACK frame become two records, nothing is acknowledged
+static void testCapture(void) {
+    byte buffer[KNX_BUSMON_FRAME_HEADER_SIZE + KNX_TELEGRAM_MAX_SIZE];
+    KnxTelegram t;
+    byte raw[KNX_TELEGRAM_MAX_SIZE];
+    byte value = 1;
+    unsigned long end;
+
+    startBusmon();
+
+    t.setSourceAddress(P_ADDR(1,1,5));
+    t.setTargetAddress(G_ADDR(2,7,1));
+    t.setCommand(KNX_COMMAND_VALUE_WRITE);
+    t.setPayload(&value, 1);
+    t.updateChecksum();
+    for (byte i = 0; i < t.getTelegramLength(); i++) raw[i] = t.getRawByte(i);
+
+    end = mockRxFrame(raw, t.getTelegramLength(), mockNow() + 1000);
+    mockRxByte(0xCC, end + 15 * MOCK_BUS_CHARACTER_TIME);
+    runUntil(end + 30000);
+
+    CHECK_EQUAL(KNX_BUSMON_FRAME_HEADER_SIZE + t.getTelegramLength(), tpuart->readBusmonFrame(buffer, sizeof(buffer)));
+    CHECK_EQUAL(KNX_BUSMON_FRAME_SYNC, buffer[0]);
+    CHECK_EQUAL(KNX_BUSMON_FLAG_CHECKSUM_OK, buffer[1]);
+    CHECK(memcmp(&buffer[KNX_BUSMON_FRAME_HEADER_SIZE], raw, t.getTelegramLength()) == 0);
+
+    CHECK_EQUAL(KNX_BUSMON_FRAME_HEADER_SIZE + 1, tpuart->readBusmonFrame(buffer, sizeof(buffer)));
+    CHECK_EQUAL(0xCC, buffer[KNX_BUSMON_FRAME_HEADER_SIZE]);
+    CHECK_EQUAL(0, tpuart->readBusmonFrame(buffer, sizeof(buffer)));
+
+    CHECK_EQUAL(0, mockAckCount);
+    CHECK_EQUAL(0, resets);
+}
+
+// a reset indication between frames stops reception and is reported, reset() leaves bus monitor mode
+static void testResetIndication(void) {
+    startBusmon();
+
+    mockRxByte(TPUART_RESET_INDICATION, mockNow() + 1000);
+    runUntil(mockNow() + 5000);
+
+    CHECK_EQUAL(1, resets);
+    CHECK(!tpuart->isRxActive());
+    CHECK(!tpuart->isFreeToSend());
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->reset());
+    CHECK(!tpuart->isBusmonActive());
+    CHECK(!mockBusmonActive);
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->init());
+    CHECK(tpuart->isFreeToSend());
+}
+
+int main(void) {
+    testCapture();
+    testResetIndication();
+
+    delete tpuart;
+
+    return knxTestResult("test_busmon");
+}
@@ -0,0 +1,113 @@
+/*
+ *    test_change_filter.cpp
+ *
+ *    Send on change: the tag stays with the value sent or held back, and
+ *    groupWrite2ByteFixedValue passes the filter and sends the exact encoding.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+#define TAG_A 0x01
+#define TAG_B 0x02
+#define TAG_C 0x03
+
+static void run(unsigned long microsec) {
+    unsigned long end = mockNow() + microsec;
+
+    while (mockNow() < end) {
+        mockAdvance(200);
+        SimpleKnx.task();
+    }
+}
+
+// true if the last frame on the bus carries the DPT 9 encoding of centi
+static boolean lastSentCenti(long centi) {
+    byte data[2];
+
+    KnxDptCodec<9>::encodeCenti(centi, data);
+    return (mockFrames[mockFrameCount - 1].data[8] == data[0]) && (mockFrames[mockFrameCount - 1].data[9] == data[1]);
+}
+
+// a suppressed value does not change the tag of the value repeated after the maximum silence
+static void testTagOfSuppressed(void) {
+    KnxChangeFilter filter;
+    word groupAddr;
+    float value;
+    byte tag;
+
+    CHECK(filter.setFilter(G_ADDR(3,0,1), 1.0, false, 1000, 10));
+    CHECK_EQUAL(KNX_CHANGE_SEND, filter.check(G_ADDR(3,0,1), 20.0, TAG_A, 0));
+    filter.sent(G_ADDR(3,0,1), 20.0, 0);
+
+    CHECK_EQUAL(KNX_CHANGE_SUPPRESS, filter.check(G_ADDR(3,0,1), 20.5, TAG_B, 2000));
+    CHECK(!filter.pop(5000, groupAddr, value, tag));
+
+    CHECK(filter.pop(10000, groupAddr, value, tag));
+    CHECK_EQUAL(G_ADDR(3,0,1), groupAddr);
+    CHECK(value == 20.0);
+    CHECK_EQUAL(TAG_A, tag);
+}
+
+// a value held back keeps its own tag, the one sent before is not used for it
+static void testTagOfDeferred(void) {
+    KnxChangeFilter filter;
+    word groupAddr;
+    float value;
+    byte tag;
+
+    CHECK(filter.setFilter(G_ADDR(3,0,1), 1.0, false, 1000, 0));
+    CHECK_EQUAL(KNX_CHANGE_SEND, filter.check(G_ADDR(3,0,1), 20.0, TAG_A, 0));
+    filter.sent(G_ADDR(3,0,1), 20.0, 0);
+
+    CHECK_EQUAL(KNX_CHANGE_DEFER, filter.check(G_ADDR(3,0,1), 25.0, TAG_C, 100));
+
+    CHECK(filter.pop(1000, groupAddr, value, tag));
+    CHECK(value == 25.0);
+    CHECK_EQUAL(TAG_C, tag);
+}
+
+// hundredths pass the filter and go out with the encoding of encodeCenti, also when held back
+static void testFixedValue(void) {
+    int frames;
+
+    CHECK(SimpleKnx.setSendOnChange(G_ADDR(3,1,1), 0.5, false, 1000, 0));
+
+    frames = mockFrameCount;
+    CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, SimpleKnx.groupWrite2ByteFixedValue(false, G_ADDR(3,1,1), 2151));
+    run(50000);
+    CHECK_EQUAL(frames + 1, mockFrameCount);
+    CHECK(lastSentCenti(2151));
+
+    CHECK_EQUAL(KNX_TX_QUEUE_SUPPRESSED, SimpleKnx.groupWrite2ByteFixedValue(false, G_ADDR(3,1,1), 2170));
+    CHECK_EQUAL(KNX_TX_QUEUE_DEFERRED, SimpleKnx.groupWrite2ByteFixedValue(false, G_ADDR(3,1,1), 2203));
+    run(50000);
+    CHECK_EQUAL(frames + 1, mockFrameCount);
+
+    run(1000000);
+    CHECK_EQUAL(frames + 2, mockFrameCount);
+    CHECK(lastSentCenti(2203));
+
+    // group addresses without filter are not affected
+    CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, SimpleKnx.groupWrite2ByteFixedValue(false, G_ADDR(3,1,2), -1999));
+    CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, SimpleKnx.groupWrite2ByteFixedValue(false, G_ADDR(3,1,2), -1999));
+    run(100000);
+    CHECK_EQUAL(frames + 4, mockFrameCount);
+    CHECK(lastSentCenti(-1999));
+}
+
+int main(void) {
+    mockReset();
+    SimpleKnx.init(Serial, P_ADDR(1,1,12));
+
+    testTagOfSuppressed();
+    testTagOfDeferred();
+    testFixedValue();
+
+    return knxTestResult("test_change_filter");
+}
@@ -0,0 +1,292 @@
+/*
+ *    test_dpt.cpp
+ *
+ *    Known answer vectors for every datapoint codec of KnxDpt.h, in both directions:
+ *    value to payload bytes and payload bytes to value, including the sign of DPT 6,
+ *    8 and 13, the byte order of DPT 14, and values filling the top bit of 16 bit types.
+ *    Also the way through KnxTelegram::get and SimpleKnx_::groupWrite.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+typedef Dpt<1, 1> Switch;
+typedef Dpt<2, 1> SwitchControl;
+typedef Dpt<3, 7> Dimming;
+typedef Dpt<4, 1> Character;
+typedef Dpt<5, 10> Counter8;
+typedef Dpt<5, 1> Percent;
+typedef Dpt<5, 3> Angle;
+typedef Dpt<6, 10> Signed8;
+typedef Dpt<7, 1> Counter16;
+typedef Dpt<8, 1> Signed16;
+typedef Dpt<9, 1> Temperature;
+typedef Dpt<10, 1> TimeOfDay;
+typedef Dpt<11, 1> Date;
+typedef Dpt<12, 1> Counter32;
+typedef Dpt<13, 1> Signed32;
+typedef Dpt<14, 1> Float32;
+typedef Dpt<16, 1> Text;
+typedef Dpt<17, 1> Scene;
+typedef Dpt<18, 1> SceneControl;
+typedef Dpt<19, 1> DateTime;
+typedef Dpt<232, 600> Rgb;
+typedef Dpt<251, 600> Rgbw;
+
+// true if value encodes to the bytes expected, and nothing behind them is written
+template<typename D>
+static boolean encodesTo(const typename D::Type& value, const byte expected[], byte length) {
+    byte data[KNX_TELEGRAM_PAYLOAD_MAX_SIZE + 1];
+
+    memset(data, 0xAA, sizeof(data));
+    D::encode(value, data);
+
+    return (length == max(D::size, byte(1))) && (memcmp(data, expected, length) == 0) && (data[length] == 0xAA);
+}
+
+#define ENCODES(D, value, ...) do { \
+        static const byte expected[] = { __VA_ARGS__ }; \
+        CHECK(encodesTo<D>(value, expected, sizeof(expected))); \
+    } while (0)
+
+#define DECODES(D, expected, ...) do { \
+        static const byte data[] = { __VA_ARGS__ }; \
+        CHECK(D::decode(data) == (expected)); \
+    } while (0)
+
+static void testBits(void) {
+    ENCODES(Switch, true, 0x01);
+    ENCODES(Switch, false, 0x00);
+    DECODES(Switch, true, 0x01);
+    DECODES(Switch, false, 0x00);
+    DECODES(Switch, false, 0xFE);
+
+    ENCODES(SwitchControl, 0x03, 0x03);
+    ENCODES(SwitchControl, 0x06, 0x02);
+    DECODES(SwitchControl, 0x01, 0xFD);
+
+    ENCODES(Dimming, 0x0B, 0x0B);
+    ENCODES(Dimming, 0x1B, 0x0B);
+    DECODES(Dimming, 0x09, 0xF9);
+}
+
+static void testBytes(void) {
+    ENCODES(Character, 'A', 0x41);
+    DECODES(Character, 'z', 0x7A);
+
+    ENCODES(Counter8, 200, 0xC8);
+    DECODES(Counter8, 255, 0xFF);
+
+    ENCODES(Percent, 0, 0x00);
+    ENCODES(Percent, 50, 0x80);
+    ENCODES(Percent, 100, 0xFF);
+    ENCODES(Percent, 101, 0xFF);
+    DECODES(Percent, 0, 0x00);
+    DECODES(Percent, 50, 0x80);
+    DECODES(Percent, 100, 0xFF);
+
+    ENCODES(Angle, 0, 0x00);
+    ENCODES(Angle, 180, 0x80);
+    ENCODES(Angle, 360, 0xFF);
+    DECODES(Angle, 181, 0x80);
+    DECODES(Angle, 360, 0xFF);
+
+    ENCODES(Signed8, -5, 0xFB);
+    ENCODES(Signed8, -128, 0x80);
+    ENCODES(Signed8, 127, 0x7F);
+    DECODES(Signed8, -1, 0xFF);
+    DECODES(Signed8, -128, 0x80);
+    DECODES(Signed8, 127, 0x7F);
+}
+
+static void testIntegers(void) {
+    ENCODES(Counter16, 0x1234, 0x12, 0x34);
+    ENCODES(Counter16, 65000, 0xFD, 0xE8);
+    DECODES(Counter16, 0x1234, 0x12, 0x34);
+    DECODES(Counter16, 0x8000, 0x80, 0x00);
+    DECODES(Counter16, 65535, 0xFF, 0xFF);
+
+    ENCODES(Signed16, -30000, 0x8A, 0xD0);
+    ENCODES(Signed16, 32767, 0x7F, 0xFF);
+    DECODES(Signed16, -30000, 0x8A, 0xD0);
+    DECODES(Signed16, -32768, 0x80, 0x00);
+    DECODES(Signed16, -1, 0xFF, 0xFF);
+    DECODES(Signed16, 256, 0x01, 0x00);
+
+    ENCODES(Counter32, 4000000000UL, 0xEE, 0x6B, 0x28, 0x00);
+    ENCODES(Counter32, 0x01020304UL, 0x01, 0x02, 0x03, 0x04);
+    DECODES(Counter32, 4000000000UL, 0xEE, 0x6B, 0x28, 0x00);
+    DECODES(Counter32, 0xFFFFFFFFUL, 0xFF, 0xFF, 0xFF, 0xFF);
+
+    ENCODES(Signed32, -2000000000L, 0x88, 0xCA, 0x6C, 0x00);
+    ENCODES(Signed32, 1, 0x00, 0x00, 0x00, 0x01);
+    DECODES(Signed32, -2000000000L, 0x88, 0xCA, 0x6C, 0x00);
+    DECODES(Signed32, INT32_MIN, 0x80, 0x00, 0x00, 0x00);
+    DECODES(Signed32, INT32_MAX, 0x7F, 0xFF, 0xFF, 0xFF);
+    DECODES(Signed32, -1, 0xFF, 0xFF, 0xFF, 0xFF);
+}
+
+static void testFloats(void) {
+    ENCODES(Temperature, 0.0f, 0x00, 0x00);
+    ENCODES(Temperature, 20.0f, 0x07, 0xD0);
+    ENCODES(Temperature, 21.5f, 0x0C, 0x33);
+    ENCODES(Temperature, -1.0f, 0x87, 0x9C);
+    DECODES(Temperature, 20.0f, 0x07, 0xD0);
+    DECODES(Temperature, 21.5f, 0x0C, 0x33);
+    DECODES(Temperature, -1.0f, 0x87, 0x9C);
+    DECODES(Temperature, -30.0f, 0x8A, 0x24);
+
+    // hundredths, up to the largest and smallest values
+    {
+        static const byte largest[] = { 0x7F, 0xFF };
+        static const byte smallest[] = { 0xF8, 0x00 };
+        byte data[2];
+
+        KnxDptCodec<9>::encodeCenti(67076096L, data);
+        CHECK((data[0] == largest[0]) && (data[1] == largest[1]));
+        KnxDptCodec<9>::encodeCenti(-67108864L, data);
+        CHECK((data[0] == smallest[0]) && (data[1] == smallest[1]));
+        CHECK_EQUAL(67076096L, KnxDptCodec<9>::decodeCenti(largest));
+        CHECK_EQUAL(-67108864L, KnxDptCodec<9>::decodeCenti(smallest));
+        KnxDptCodec<9>::encodeCenti(-3000, data);
+        CHECK((data[0] == 0x8A) && (data[1] == 0x24));
+    }
+
+    // most significant byte first, as the standard requires
+    ENCODES(Float32, 1.0f, 0x3F, 0x80, 0x00, 0x00);
+    ENCODES(Float32, -2.5f, 0xC0, 0x20, 0x00, 0x00);
+    ENCODES(Float32, 3.14159274f, 0x40, 0x49, 0x0F, 0xDB);
+    DECODES(Float32, 1.0f, 0x3F, 0x80, 0x00, 0x00);
+    DECODES(Float32, -2.5f, 0xC0, 0x20, 0x00, 0x00);
+    DECODES(Float32, 3.14159274f, 0x40, 0x49, 0x0F, 0xDB);
+}
+
+static void testTimes(void) {
+    KnxDptTime time = { 3, 13, 45, 9 };
+    KnxDptDate date = { 16, 10, 2026 };
+    KnxDptDateTime dateTime = { 2026, 10, 16, 5, 23, 59, 58, 0x2080 };
+
+    ENCODES(TimeOfDay, time, 0x6D, 0x2D, 0x09);
+    {
+        static const byte data[] = { 0xF7, 0x3B, 0x3B };
+        KnxDptTime t = TimeOfDay::decode(data);
+        CHECK((t.weekday == 7) && (t.hour == 23) && (t.minute == 59) && (t.second == 59));
+    }
+
+    ENCODES(Date, date, 0x10, 0x0A, 0x1A);
+    {
+        static const byte data1990[] = { 0x01, 0x01, 0x5A };
+        static const byte data2089[] = { 0x1F, 0x0C, 0x59 };
+        KnxDptDate d = Date::decode(data1990);
+        CHECK((d.day == 1) && (d.month == 1) && (d.year == 1990));
+        d = Date::decode(data2089);
+        CHECK((d.day == 31) && (d.month == 12) && (d.year == 2089));
+    }
+
+    ENCODES(DateTime, dateTime, 0x7E, 0x0A, 0x10, 0xB7, 0x3B, 0x3A, 0x20, 0x80);
+    {
+        static const byte data[] = { 0xFF, 0x0C, 0x1F, 0xE0, 0x00, 0x00, 0xFF, 0xFE };
+        KnxDptDateTime d = DateTime::decode(data);
+        CHECK((d.year == 2155) && (d.month == 12) && (d.day == 31) && (d.weekday == 7));
+        CHECK((d.hour == 0) && (d.minute == 0) && (d.second == 0));
+        CHECK_EQUAL(0xFFFE, d.flags);
+    }
+}
+
+static void testComposed(void) {
+    KnxDptString text = { "Hello KNX!" };
+    KnxDptRgb rgb = { 0x01, 0x80, 0xFF };
+    KnxDptRgbw rgbw = { 0x01, 0x02, 0x03, 0x04, 0x0F };
+
+    ENCODES(Text, text, 'H', 'e', 'l', 'l', 'o', ' ', 'K', 'N', 'X', '!', 0, 0, 0, 0);
+    {
+        static const byte data[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '1', '2', '3', '4' };
+        CHECK(strcmp(Text::decode(data).text, "12345678901234") == 0);
+    }
+
+    ENCODES(Scene, 63, 0x3F);
+    ENCODES(Scene, 0x45, 0x05);
+    DECODES(Scene, 0x05, 0xC5);
+
+    ENCODES(SceneControl, 0x85, 0x85);
+    ENCODES(SceneControl, 0xC5, 0x85);
+    DECODES(SceneControl, 0x85, 0xC5);
+
+    ENCODES(Rgb, rgb, 0x01, 0x80, 0xFF);
+    {
+        static const byte data[] = { 0xFF, 0x00, 0x7F };
+        KnxDptRgb c = Rgb::decode(data);
+        CHECK((c.red == 0xFF) && (c.green == 0x00) && (c.blue == 0x7F));
+    }
+
+    ENCODES(Rgbw, rgbw, 0x01, 0x02, 0x03, 0x04, 0x00, 0x0F);
+    {
+        static const byte data[] = { 0x10, 0x20, 0x30, 0x40, 0xFF, 0xFA };
+        KnxDptRgbw c = Rgbw::decode(data);
+        CHECK((c.red == 0x10) && (c.green == 0x20) && (c.blue == 0x30) && (c.white == 0x40) && (c.valid == 0x0A));
+    }
+}
+
+// payload bytes of a received frame are read with KnxTelegram::get, checked against the length
+static void testTelegram(void) {
+    static const byte signed32[] = { 0x88, 0xCA, 0x6C, 0x00 };
+    static const byte float32[] = { 0xC0, 0x20, 0x00, 0x00 };
+    KnxTelegram t;
+    byte value = 1;
+
+    t.setCommand(KNX_COMMAND_VALUE_WRITE);
+    t.setPayload(signed32, 4);
+    CHECK_EQUAL(-2000000000L, t.get<Signed32>());
+    CHECK_EQUAL(0x88CA6C00UL, t.get<Counter32>());
+
+    t.setPayload(float32, 4);
+    CHECK(t.get<Float32>() == -2.5f);
+    CHECK(t.get<Temperature>() == 0.0f);
+
+    t.clearTelegram();
+    t.setCommand(KNX_COMMAND_VALUE_WRITE);
+    t.setPayload(&value, 0);
+    CHECK_EQUAL(true, t.get<Switch>());
+    CHECK_EQUAL(0, t.get<Counter16>());
+}
+
+// groupWrite sends the encoded bytes behind the command field
+static void testGroupWrite(void) {
+    unsigned long end;
+
+    mockReset();
+    SimpleKnx.init(Serial, P_ADDR(1,1,12));
+
+    CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, SimpleKnx.groupWrite<Float32>(false, G_ADDR(1,0,1), -2.5f));
+    CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, SimpleKnx.groupWrite<Signed16>(false, G_ADDR(1,0,2), -30000));
+
+    end = mockNow() + 200000;
+    while (mockNow() < end) {
+        mockAdvance(200);
+        SimpleKnx.task();
+    }
+
+    CHECK_EQUAL(2, mockFrameCount);
+    CHECK_EQUAL(13, mockFrames[0].length);
+    CHECK((mockFrames[0].data[8] == 0xC0) && (mockFrames[0].data[9] == 0x20) && (mockFrames[0].data[10] == 0x00) && (mockFrames[0].data[11] == 0x00));
+    CHECK_EQUAL(11, mockFrames[1].length);
+    CHECK((mockFrames[1].data[8] == 0x8A) && (mockFrames[1].data[9] == 0xD0));
+}
+
+int main(void) {
+    testBits();
+    testBytes();
+    testIntegers();
+    testFloats();
+    testTimes();
+    testComposed();
+    testTelegram();
+    testGroupWrite();
+
+    return knxTestResult("test_dpt");
+}
@@ -0,0 +1,94 @@
+/*
+ *    test_dpt9.cpp
+ *
+ *    KnxDptCodec<9> against the former float conversions of FormerDpt9.h, bit by bit:
+ *    all 65536 raw values decoded, the values decoded encoded again, every hundredth
+ *    of the DPT 9 range encoded by encodeCenti, and random floats encoded.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+#include "FormerDpt9.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+#define CENTI_MIN -67108864L // -671088.64
+#define CENTI_MAX  67076096L //  670760.96
+
+static boolean sameBytes(const byte a[], const byte b[]) {
+    return (a[0] == b[0]) && (a[1] == b[1]);
+}
+
+static boolean sameFloat(float a, float b) {
+    return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+// decoding all raw values gives the former float, and the hundredths it was computed from
+static void testRawDomain(void) {
+    long floatDiffs = 0, centiDiffs = 0, encodeDiffs = 0;
+
+    for (long raw = 0; raw <= 0xFFFF; raw++) {
+        byte data[2] = { byte(raw >> 8), byte(raw) };
+        byte former[2], current[2];
+        float value = FormerDpt9::decode(data);
+
+        if (!sameFloat(value, Dpt<9, 1>::decode(data))) floatDiffs++;
+        if (!sameFloat(value, 0.01 * KnxDptCodec<9>::decodeCenti(data))) centiDiffs++;
+
+        FormerDpt9::encode(value, former);
+        Dpt<9, 1>::encode(value, current);
+        if (!sameBytes(former, current)) encodeDiffs++;
+    }
+
+    CHECK_EQUAL(0, floatDiffs);
+    CHECK_EQUAL(0, centiDiffs);
+    CHECK_EQUAL(0, encodeDiffs);
+}
+
+// every hundredth of the range is encoded as by the former normalization loop
+static void testCentiDomain(void) {
+    long diffs = 0;
+    long first = 0;
+
+    for (long centi = CENTI_MIN; centi <= CENTI_MAX; centi++) {
+        byte former[2], current[2];
+
+        FormerDpt9::encodeCenti(centi, former);
+        KnxDptCodec<9>::encodeCenti(centi, current);
+        if (!sameBytes(former, current) && (diffs++ == 0)) first = centi;
+    }
+
+    if (diffs > 0) printf("first difference at %ld\n", first);
+    CHECK_EQUAL(0, diffs);
+}
+
+// floats between the hundredths encode as before, rounding included
+static void testRandomFloats(void) {
+    long diffs = 0;
+
+    srand(1);
+    for (long i = 0; i < 1000000; i++) {
+        float value = (float)(CENTI_MIN + ((long long)rand() * (CENTI_MAX - CENTI_MIN)) / RAND_MAX) / 100.0f;
+        byte former[2], current[2];
+
+        // also values close to zero, where the mantissa is not shifted
+        if (i & 1) value /= 10000.0f;
+
+        FormerDpt9::encode(value, former);
+        Dpt<9, 1>::encode(value, current);
+        if (!sameBytes(former, current)) diffs++;
+    }
+
+    CHECK_EQUAL(0, diffs);
+}
+
+int main(void) {
+    testRawDomain();
+    testCentiDomain();
+    testRandomFloats();
+
+    return knxTestResult("test_dpt9");
+}
@@ -0,0 +1,190 @@
+/*
+ *    test_eop.cpp
+ *
+ *    End of packet detection of KnxTpUart on the simulated clock: a frame cut short
+ *    is dropped after KNX_RX_EOP_GAP of silence, and the next frame is received.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1), G_ADDR(2,7,2));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+static const word groupAddresses[] = { G_ADDR(2,7,1), G_ADDR(2,7,2) };
+static KnxTpUart *tpuart;
+static int receptionErrors;
+
+static void events(KnxTpUartEvent event) {
+    if (event == TPUART_EVENT_KNX_TELEGRAM_RECEPTION_ERROR) receptionErrors++;
+}
+
+static KnxTelegram telegram(word groupAddress, byte value) {
+    KnxTelegram t;
+
+    t.setSourceAddress(P_ADDR(1,1,5));
+    t.setTargetAddress(groupAddress);
+    t.setCommand(KNX_COMMAND_VALUE_WRITE);
+    t.setPayload(&value, 1);
+    t.updateChecksum();
+
+    return t;
+}
+
+static unsigned long sendFrame(const KnxTelegram& t, byte length, unsigned long timeMicrosec) {
+    byte raw[KNX_TELEGRAM_MAX_SIZE];
+
+    for (byte i = 0; i < length; i++) raw[i] = t.getRawByte(i);
+
+    return mockRxFrame(raw, length, timeMicrosec);
+}
+
+static void runUntil(unsigned long timeMicrosec, unsigned long loopMicrosec) {
+    while (mockNow() < timeMicrosec) {
+        mockAdvance(loopMicrosec);
+        tpuart->rxTask();
+    }
+}
+
+static int drainValues(byte values[]) {
+    int count = 0;
+
+    while (tpuart->peekReceivedTelegram() != NULL) {
+        values[count++] = tpuart->peekReceivedTelegram()->get1ByteIntValue();
+        tpuart->popReceivedTelegram();
+    }
+
+    return count;
+}
+
+static void startTpUart(void) {
+    mockReset();
+    delete tpuart;
+    tpuart = new KnxTpUart(Serial, P_ADDR(1,1,12), groupAddresses, 2);
+    receptionErrors = 0;
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->reset());
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->setEvtCallback(events));
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->init());
+}
+
+// the receiver is back in idle within the gap after the last byte of a truncated frame
+static void testRecoveryTime(void) {
+    KnxTelegram a = telegram(G_ADDR(2,7,1), 1);
+    unsigned long last, idle = 0;
+
+    startTpUart();
+
+    last = sendFrame(a, 7, mockNow() + 1000);
+    runUntil(last, 100);
+    CHECK(tpuart->isRxActive());
+
+    while (mockNow() < last + 50000) {
+        mockAdvance(100);
+        tpuart->rxTask();
+        if (!tpuart->isRxActive()) {
+            idle = mockNow();
+            break;
+        }
+    }
+
+    CHECK(idle > last + KNX_RX_EOP_GAP);
+    CHECK(idle <= last + KNX_RX_EOP_GAP + 200);
+    CHECK_EQUAL(1, receptionErrors);
+}
+
+// a frame following a truncated one after a short pause is received
+static void testTruncatedThenFrame(void) {
+    byte values[8];
+    KnxTelegram a = telegram(G_ADDR(2,7,1), 1);
+    KnxTelegram b = telegram(G_ADDR(2,7,2), 2);
+    unsigned long t;
+
+    startTpUart();
+
+    t = sendFrame(a, 7, mockNow() + 1000);
+    t = sendFrame(b, b.getTelegramLength(), t + KNX_RX_EOP_GAP + 1000);
+    runUntil(t + 10000, 100);
+
+    CHECK_EQUAL(1, drainValues(values));
+    CHECK_EQUAL(2, values[0]);
+    CHECK_EQUAL(1, receptionErrors);
+}
+
+// frames with the shortest bus pause in between are kept apart
+static void testBackToBack(void) {
+    byte values[8];
+    KnxTelegram a = telegram(G_ADDR(2,7,1), 1);
+    unsigned long t = mockNow() + 1000;
+
+    startTpUart();
+
+    for (byte k = 0; k < 3; k++) {
+        a.setPayload(&k, 1);
+        a.updateChecksum();
+        t = sendFrame(a, a.getTelegramLength(), t + 4 * MOCK_BUS_CHARACTER_TIME);
+    }
+    runUntil(t + 10000, 100);
+
+    CHECK_EQUAL(3, drainValues(values));
+    CHECK_EQUAL(0, values[0]);
+    CHECK_EQUAL(2, values[2]);
+    CHECK_EQUAL(0, receptionErrors);
+}
+
+// with a gap configured longer than the pause, the two frames run into each other
+static void testConfiguredGap(void) {
+    byte values[8];
+    KnxTelegram a = telegram(G_ADDR(2,7,1), 1);
+    KnxTelegram b = telegram(G_ADDR(2,7,2), 2);
+    unsigned long t;
+
+    startTpUart();
+    tpuart->setRxEopGap(10000);
+
+    t = sendFrame(a, 7, mockNow() + 1000);
+    t = sendFrame(b, b.getTelegramLength(), t + 5000);
+    runUntil(t + 20000, 100);
+
+    CHECK_EQUAL(0, drainValues(values));
+
+    // and the default recovers
+    tpuart->setRxEopGap(KNX_RX_EOP_GAP);
+    t = sendFrame(a, 7, mockNow() + 1000);
+    t = sendFrame(b, b.getTelegramLength(), t + 5000);
+    runUntil(t + 20000, 100);
+
+    CHECK_EQUAL(1, drainValues(values));
+    CHECK_EQUAL(2, values[0]);
+}
+
+// a slow main loop only sees whole bursts, EOP is found between them
+static void testSlowLoop(void) {
+    byte values[8];
+    KnxTelegram a = telegram(G_ADDR(2,7,1), 1);
+    KnxTelegram b = telegram(G_ADDR(2,7,2), 2);
+    unsigned long t;
+
+    startTpUart();
+
+    t = sendFrame(a, a.getTelegramLength(), mockNow() + 1000);
+    t = sendFrame(b, b.getTelegramLength(), t + 20000);
+    runUntil(t + 20000, 2000);
+
+    CHECK_EQUAL(2, drainValues(values));
+    CHECK_EQUAL(0, receptionErrors);
+}
+
+int main(void) {
+    testRecoveryTime();
+    testTruncatedThenFrame();
+    testBackToBack();
+    testConfiguredGap();
+    testSlowLoop();
+
+    delete tpuart;
+
+    return knxTestResult("test_eop");
+}
@@ -0,0 +1,139 @@
+/*
+ *    test_ext_rx.cpp
+ *
+ *    Reception of extended frames: the slot is allocated ahead of the ACK window,
+ *    a busy or missing slot is answered BUSY. Built with -fcheck-new, so a failing
+ *    allocation returns NULL as on AVR.
+ */
+
+#include <new>
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+static boolean outOfMemory;
+static unsigned long allocTime;
+
+void *operator new(size_t size) {
+    allocTime = mockNow();
+    return outOfMemory ? NULL : malloc(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+static const word groupAddresses[] = { G_ADDR(2,7,1) };
+static KnxTpUart *tpuart;
+static KnxExtTelegram frame;
+static byte raw[KNX_EXT_TELEGRAM_MAX_SIZE];
+static byte payload[40];
+
+static void events(KnxTpUartEvent) {}
+
+static void runUntil(unsigned long timeMicrosec) {
+    while (mockNow() < timeMicrosec) {
+        mockAdvance(100);
+        tpuart->rxTask();
+    }
+}
+
+static void startTpUart(void) {
+    mockReset();
+    delete tpuart;
+    tpuart = new KnxTpUart(Serial, P_ADDR(1,1,12), groupAddresses, 1);
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->reset());
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->setEvtCallback(events));
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->init());
+}
+
+// sends the frame and returns the ACK service given by the device
+static byte receive(unsigned long *ackDelay) {
+    unsigned long start = mockNow() + 1000;
+    int acks = mockAckCount;
+
+    mockRxFrame(raw, frame.getTelegramLength(), start);
+    runUntil(start + frame.getTelegramLength() * MOCK_BUS_CHARACTER_TIME + 10000);
+
+    if (mockAckCount != acks + 1) return 0;
+    if (ackDelay != NULL) *ackDelay = mockAcks[acks].time - (start + (KNX_TELEGRAM_HEADER_SIZE - 1) * MOCK_BUS_CHARACTER_TIME);
+
+    return mockAcks[acks].service;
+}
+
+static void testReceive(void) {
+    unsigned long ackDelay = 0;
+    unsigned long start;
+
+    startTpUart();
+
+    // the slot is allocated with the control field, before the address is complete
+    start = mockNow() + 1000;
+    CHECK_EQUAL(TPUART_RX_ACK_SERVICE_ADDRESSED, receive(&ackDelay));
+    CHECK(allocTime < start + MOCK_BUS_CHARACTER_TIME);
+    CHECK(ackDelay < 1700);
+    CHECK(tpuart->peekReceivedExtTelegram() != NULL);
+    CHECK_EQUAL(41, tpuart->peekReceivedExtTelegram()->getPayloadLength());
+    CHECK(memcmp(tpuart->peekReceivedExtTelegram()->getPayload(), payload, sizeof(payload)) == 0);
+
+    // the slot is still taken
+    CHECK_EQUAL(TPUART_RX_ACK_SERVICE_BUSY, receive(NULL));
+
+    tpuart->popReceivedExtTelegram();
+    CHECK_EQUAL(TPUART_RX_ACK_SERVICE_ADDRESSED, receive(NULL));
+    CHECK(tpuart->peekReceivedExtTelegram() != NULL);
+}
+
+// without memory for the slot the frame gets BUSY, standard frames still work
+static void testOutOfMemory(void) {
+    KnxTelegram t;
+    byte value = 7;
+    byte standard[KNX_TELEGRAM_MAX_SIZE];
+
+    startTpUart();
+
+    outOfMemory = true;
+    CHECK_EQUAL(TPUART_RX_ACK_SERVICE_BUSY, receive(NULL));
+    CHECK(tpuart->peekReceivedExtTelegram() == NULL);
+
+    t.setSourceAddress(P_ADDR(1,1,5));
+    t.setTargetAddress(G_ADDR(2,7,1));
+    t.setCommand(KNX_COMMAND_VALUE_WRITE);
+    t.setPayload(&value, 1);
+    t.updateChecksum();
+    for (byte i = 0; i < t.getTelegramLength(); i++) standard[i] = t.getRawByte(i);
+    mockRxFrame(standard, t.getTelegramLength(), mockNow() + 1000);
+    runUntil(mockNow() + 30000);
+    CHECK(tpuart->peekReceivedTelegram() != NULL);
+    outOfMemory = false;
+
+    // memory is back
+    CHECK_EQUAL(TPUART_RX_ACK_SERVICE_ADDRESSED, receive(NULL));
+    CHECK(tpuart->peekReceivedExtTelegram() != NULL);
+}
+
+int main(void) {
+    for (byte i = 0; i < sizeof(payload); i++) payload[i] = 3 * i;
+
+    frame.setSourceAddress(P_ADDR(1,1,5));
+    frame.setTargetAddress(G_ADDR(2,7,1));
+    frame.setCommand(KNX_COMMAND_VALUE_WRITE);
+    frame.setPayload(payload, sizeof(payload));
+    for (byte i = 0; i < frame.getTelegramLength(); i++) raw[i] = frame.getRawByte(i);
+
+    testReceive();
+    testOutOfMemory();
+
+    delete tpuart;
+
+    return knxTestResult("test_ext_rx");
+}
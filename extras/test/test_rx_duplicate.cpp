@@ -0,0 +1,117 @@
+/*
+ *    test_rx_duplicate.cpp
+ *
+ *    Repeated telegrams: a repetition of a telegram delivered within
+ *    KNX_RX_DUPLICATE_WINDOW is acknowledged and counted but not delivered again,
+ *    anything else that only looks alike is delivered.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1), G_ADDR(2,7,2));
+
+static int delivered;
+static byte lastValue;
+
+void telegramReceivedCallback(const KnxTelegram& telegram) {
+    delivered++;
+    lastValue = telegram.get1ByteIntValue();
+}
+
+static void run(unsigned long microsec) {
+    unsigned long end = mockNow() + microsec;
+
+    while (mockNow() < end) {
+        mockAdvance(200);
+        SimpleKnx.task();
+    }
+}
+
+// receives a telegram, returns true if it was delivered and acknowledged
+static boolean receive(word sourceAddress, word groupAddress, byte value, boolean repeated) {
+    KnxTelegram t;
+    byte raw[KNX_TELEGRAM_MAX_SIZE];
+    int before = delivered;
+    int acks = mockAckCount;
+
+    t.setSourceAddress(sourceAddress);
+    t.setTargetAddress(groupAddress);
+    t.setCommand(KNX_COMMAND_VALUE_WRITE);
+    t.setPayload(&value, 1);
+    if (repeated) t.setRepeated();
+    t.updateChecksum();
+    for (byte i = 0; i < t.getTelegramLength(); i++) raw[i] = t.getRawByte(i);
+
+    mockRxFrame(raw, t.getTelegramLength(), mockNow() + 1000);
+    run(50000);
+
+    // a dropped repetition is acknowledged all the same, so the sender stops repeating
+    CHECK_EQUAL(acks + 1, mockAckCount);
+    CHECK_EQUAL(TPUART_RX_ACK_SERVICE_ADDRESSED, mockAcks[mockAckCount - 1].service);
+
+    return (delivered == before + 1) && (lastValue == value);
+}
+
+#define SENDER P_ADDR(1,1,5)
+
+static void testRepeated(void) {
+    CHECK(receive(SENDER, G_ADDR(2,7,1), 10, false));
+    CHECK(!receive(SENDER, G_ADDR(2,7,1), 10, true));
+    CHECK(!receive(SENDER, G_ADDR(2,7,1), 10, true));
+    CHECK_EQUAL(2, SimpleKnx.getRxDuplicateCount());
+
+    // the same value sent again as a new telegram
+    CHECK(receive(SENDER, G_ADDR(2,7,1), 10, false));
+    CHECK_EQUAL(2, SimpleKnx.getRxDuplicateCount());
+}
+
+// repetitions differing in source, target or value, and repetitions of nothing delivered
+static void testDifferent(void) {
+    byte duplicates = SimpleKnx.getRxDuplicateCount();
+
+    CHECK(receive(SENDER, G_ADDR(2,7,1), 20, false));
+    CHECK(receive(SENDER, G_ADDR(2,7,1), 21, true));
+    CHECK(receive(P_ADDR(1,1,6), G_ADDR(2,7,1), 21, true));
+    CHECK(receive(SENDER, G_ADDR(2,7,2), 21, true));
+    CHECK(receive(P_ADDR(1,1,7), G_ADDR(2,7,2), 30, true));
+    CHECK_EQUAL(duplicates, SimpleKnx.getRxDuplicateCount());
+}
+
+// a repetition after the window is delivered
+static void testWindow(void) {
+    byte duplicates = SimpleKnx.getRxDuplicateCount();
+
+    CHECK(receive(SENDER, G_ADDR(2,7,1), 40, false));
+    run((KNX_RX_DUPLICATE_WINDOW - 200) * 1000UL);
+    CHECK(!receive(SENDER, G_ADDR(2,7,1), 40, true));
+
+    CHECK(receive(SENDER, G_ADDR(2,7,1), 41, false));
+    run((KNX_RX_DUPLICATE_WINDOW + 100) * 1000UL);
+    CHECK(receive(SENDER, G_ADDR(2,7,1), 41, true));
+    CHECK_EQUAL(duplicates + 1, SimpleKnx.getRxDuplicateCount());
+}
+
+// the cache holds the last KNX_RX_DUPLICATE_CACHE_SIZE telegrams
+static void testCacheSize(void) {
+    byte duplicates = SimpleKnx.getRxDuplicateCount();
+
+    for (byte i = 0; i <= KNX_RX_DUPLICATE_CACHE_SIZE; i++) CHECK(receive(SENDER, G_ADDR(2,7,1), 50 + i, false));
+
+    CHECK(!receive(SENDER, G_ADDR(2,7,1), 50 + KNX_RX_DUPLICATE_CACHE_SIZE, true));
+    CHECK(receive(SENDER, G_ADDR(2,7,1), 50, true));
+    CHECK_EQUAL(duplicates + 1, SimpleKnx.getRxDuplicateCount());
+}
+
+int main(void) {
+    mockReset();
+    SimpleKnx.init(Serial, P_ADDR(1,1,12));
+
+    testRepeated();
+    testDifferent();
+    testWindow();
+    testCacheSize();
+
+    return knxTestResult("test_rx_duplicate");
+}
@@ -0,0 +1,212 @@
+/*
+ *    test_rx_isr.cpp
+ *
+ *    Interrupt driven reception (KNX_RX_ISR): the SPSC ring, the drain by rxTask
+ *    and EOP detection from the arrival times stored by rxIsr.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1), G_ADDR(2,7,2));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+static const word groupAddresses[] = { G_ADDR(2,7,1), G_ADDR(2,7,2) };
+static KnxTpUart *tpuart;
+static int receptionErrors;
+
+static void isr(void) {
+    tpuart->rxIsr();
+}
+
+static void events(KnxTpUartEvent event) {
+    if (event == TPUART_EVENT_KNX_TELEGRAM_RECEPTION_ERROR) receptionErrors++;
+}
+
+static KnxTelegram telegram(word groupAddress, byte value) {
+    KnxTelegram t;
+
+    t.setSourceAddress(P_ADDR(1,1,5));
+    t.setTargetAddress(groupAddress);
+    t.setCommand(KNX_COMMAND_VALUE_WRITE);
+    t.setPayload(&value, 1);
+    t.updateChecksum();
+
+    return t;
+}
+
+static unsigned long sendFrame(const KnxTelegram& t, byte length, unsigned long timeMicrosec) {
+    byte raw[KNX_TELEGRAM_MAX_SIZE];
+
+    for (byte i = 0; i < length; i++) raw[i] = t.getRawByte(i);
+
+    return mockRxFrame(raw, length, timeMicrosec);
+}
+
+// main loop calling rxTask every loopMicrosec until the time given
+static void runUntil(unsigned long timeMicrosec, unsigned long loopMicrosec) {
+    while (mockNow() < timeMicrosec) {
+        mockAdvance(loopMicrosec);
+        tpuart->rxTask();
+    }
+}
+
+static int drainValues(byte values[]) {
+    int count = 0;
+
+    while (tpuart->peekReceivedTelegram() != NULL) {
+        values[count++] = tpuart->peekReceivedTelegram()->get1ByteIntValue();
+        tpuart->popReceivedTelegram();
+    }
+
+    return count;
+}
+
+static void testRing(void) {
+    SpscRingBuff<byte, 8> ring;
+    byte data = 0;
+
+    // one slot stays free
+    for (byte i = 0; i < 7; i++) CHECK(ring.push(i));
+    CHECK(!ring.push(7));
+    CHECK_EQUAL(7, ring.getItemCount());
+    CHECK_EQUAL(1, ring.getOverflowCount());
+
+    for (byte i = 0; i < 7; i++) {
+        CHECK(ring.pop(data));
+        CHECK_EQUAL(i, data);
+    }
+    CHECK(!ring.pop(data));
+    CHECK(ring.isEmpty());
+
+    // wraps around keeping the order
+    for (byte i = 0; i < 40; i++) {
+        CHECK(ring.push(i));
+        CHECK(ring.push(i + 100));
+        CHECK(ring.pop(data));
+        CHECK_EQUAL(i, data);
+        CHECK(ring.pop(data));
+        CHECK_EQUAL(i + 100, data);
+    }
+
+    // overflow count saturates
+    for (int i = 0; i < 300; i++) ring.push(0);
+    CHECK_EQUAL(255, ring.getOverflowCount());
+
+    ring.clear();
+    CHECK_EQUAL(0, ring.getItemCount());
+}
+
+static void startTpUart(void) {
+    mockReset();
+    delete tpuart;
+    tpuart = new KnxTpUart(Serial, P_ADDR(1,1,12), groupAddresses, 2);
+    receptionErrors = 0;
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->reset());
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->setEvtCallback(events));
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->init());
+    mockSetRxInterrupt(isr);
+}
+
+// frames arriving while the main loop runs fast
+static void testFastLoop(void) {
+    byte values[8];
+    KnxTelegram a = telegram(G_ADDR(2,7,1), 1);
+    KnxTelegram b = telegram(G_ADDR(2,7,2), 2);
+    unsigned long t;
+
+    startTpUart();
+
+    t = sendFrame(a, a.getTelegramLength(), mockNow() + 1000);
+    t = sendFrame(b, b.getTelegramLength(), t + 4000);
+    runUntil(t + 10000, 100);
+
+    CHECK_EQUAL(2, drainValues(values));
+    CHECK_EQUAL(1, values[0]);
+    CHECK_EQUAL(2, values[1]);
+    CHECK_EQUAL(0, receptionErrors);
+    CHECK_EQUAL(0, tpuart->getRxIsrOverflowCount());
+}
+
+// the main loop stalls while a truncated and a complete frame arrive. Only the
+// arrival times stored by the interrupt show the gap between them.
+static void testStalledLoop(void) {
+    byte values[8];
+    KnxTelegram a = telegram(G_ADDR(2,7,1), 1);
+    KnxTelegram b = telegram(G_ADDR(2,7,2), 2);
+    unsigned long t;
+
+    startTpUart();
+
+    t = sendFrame(a, 5, mockNow() + 1000);
+    t = sendFrame(b, b.getTelegramLength(), t + 4000);
+    mockAdvanceTo(t + 1000);
+    CHECK_EQUAL(0, mockRxPending());
+
+    runUntil(mockNow() + 10000, 100);
+
+    CHECK_EQUAL(1, drainValues(values));
+    CHECK_EQUAL(2, values[0]);
+    CHECK_EQUAL(1, receptionErrors);
+    CHECK_EQUAL(0, tpuart->getRxIsrOverflowCount());
+}
+
+// a frame split by a gap is dropped even if both parts are drained in one burst
+static void testGapInsideBurst(void) {
+    byte values[8];
+    KnxTelegram a = telegram(G_ADDR(2,7,1), 1);
+    byte raw[KNX_TELEGRAM_MAX_SIZE];
+    unsigned long t;
+
+    startTpUart();
+
+    for (byte i = 0; i < a.getTelegramLength(); i++) raw[i] = a.getRawByte(i);
+    t = mockRxFrame(raw, 4, mockNow() + 1000);
+    t = mockRxFrame(raw + 4, a.getTelegramLength() - 4, t + 5000);
+    mockAdvanceTo(t + 1000);
+
+    runUntil(mockNow() + 10000, 100);
+
+    CHECK_EQUAL(0, drainValues(values));
+    CHECK(receptionErrors >= 1);
+}
+
+// more bytes than the ring holds arrive while the loop stalls
+static void testOverflow(void) {
+    byte values[8];
+    KnxTelegram a = telegram(G_ADDR(2,7,1), 1);
+    unsigned long t = mockNow() + 1000;
+
+    startTpUart();
+
+    for (byte k = 0; k < 5; k++) t = sendFrame(a, a.getTelegramLength(), t + 3000);
+    mockAdvanceTo(t + 1000);
+    CHECK(tpuart->getRxIsrOverflowCount() > 0);
+    CHECK_EQUAL(0, mockRxLostCount());
+
+    // the ring is full, the first frames are delivered once the loop runs again
+    runUntil(mockNow() + 10000, 100);
+    CHECK(drainValues(values) >= 3);
+
+    // and reception recovers
+    KnxTelegram b = telegram(G_ADDR(2,7,2), 2);
+    t = sendFrame(b, b.getTelegramLength(), mockNow() + 1000);
+    runUntil(t + 10000, 100);
+    CHECK_EQUAL(1, drainValues(values));
+    CHECK_EQUAL(2, values[0]);
+}
+
+int main(void) {
+    testRing();
+    testFastLoop();
+    testStalledLoop();
+    testGapInsideBurst();
+    testOverflow();
+
+    delete tpuart;
+
+    return knxTestResult("test_rx_isr");
+}
@@ -0,0 +1,127 @@
+/*
+ *    test_timer_wheel.cpp
+ *
+ *    Cyclic timers on the two level wheel: periods within level 0, within level 1 and
+ *    beyond it in the overflow slot expire on their due tick, also across the
+ *    wraparound of millis() and of the tick counter, and when a call of advance
+ *    runs many ticks at once.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+#define TICKS      80000UL // more than the 65536 of the tick counter
+#define WRAP_TICK  30000UL // millis() wraps around at this tick
+
+// periods in ticks: level 0, up to its last slot, level 1, up to its last slot, beyond
+static const word periods[KNX_CYCLIC_SIZE] = { 1, 7, 15, 16, 200, 255, 256, 4000 };
+
+static unsigned long tickNow;
+static unsigned long lastFired[KNX_CYCLIC_SIZE];
+static unsigned long firstFired[KNX_CYCLIC_SIZE];
+static unsigned long fireCount[KNX_CYCLIC_SIZE];
+static unsigned long gapFireCount[KNX_CYCLIC_SIZE];
+static unsigned long lateCount;
+
+// timers are numbered by the sub group of their group address
+static void timerExpired(word groupAddr) {
+    byte index = byte(groupAddr);
+
+    if (fireCount[index] == 0) {
+        firstFired[index] = tickNow;
+    } else if (tickNow - lastFired[index] != periods[index]) {
+        lateCount++;
+    }
+    lastFired[index] = tickNow;
+    fireCount[index]++;
+}
+
+static void gapTimerExpired(word groupAddr) {
+    gapFireCount[byte(groupAddr)]++;
+}
+
+static void setTimers(KnxTimerWheel& wheel, word seed) {
+    wheel.setSeed(seed);
+    for (byte i = 0; i < KNX_CYCLIC_SIZE; i++) {
+        CHECK(wheel.setTimer(G_ADDR(1, 0, i), (unsigned long)periods[i] * KNX_CYCLIC_TICK));
+    }
+    CHECK(!wheel.setTimer(G_ADDR(1, 1, 0), 1000));
+}
+
+// a tick per call of advance, millis() wraps around on the way. Every timer fires
+// within its first period, then exactly every period.
+static void testDueTicks(void) {
+    mockMillisOffset = 0 - millis() - WRAP_TICK * KNX_CYCLIC_TICK;
+
+    KnxTimerWheel wheel;
+    unsigned long base = millis();
+
+    memset(fireCount, 0, sizeof(fireCount));
+    lateCount = 0;
+    setTimers(wheel, 0x1234);
+
+    for (tickNow = 1; tickNow <= TICKS; tickNow++) {
+        unsigned long nowTime = base + tickNow * KNX_CYCLIC_TICK;
+
+        // a call before the tick is due runs nothing
+        wheel.advance(nowTime - 1, timerExpired);
+        wheel.advance(nowTime, timerExpired);
+    }
+    CHECK(base + TICKS * KNX_CYCLIC_TICK < base);
+
+    for (byte i = 0; i < KNX_CYCLIC_SIZE; i++) {
+        CHECK(firstFired[i] >= 1);
+        CHECK(firstFired[i] <= periods[i]);
+        CHECK_EQUAL((TICKS - firstFired[i]) / periods[i] + 1, fireCount[i]);
+    }
+    CHECK_EQUAL(0, lateCount);
+}
+
+// many ticks in one call of advance expire the same timers as one tick per call
+static void testGaps(void) {
+    static const word gaps[] = { 1, 3, 16, 17, 255, 256, 300, 5000 };
+    unsigned long diffs = 0;
+    unsigned long gapEnd = gaps[0];
+    byte g = 0;
+
+    KnxTimerWheel stepped;
+    KnxTimerWheel gapped;
+    unsigned long base = millis();
+
+    memset(fireCount, 0, sizeof(fireCount));
+    memset(gapFireCount, 0, sizeof(gapFireCount));
+    lateCount = 0;
+    setTimers(stepped, 0x4321);
+    setTimers(gapped, 0x4321);
+
+    for (tickNow = 1; tickNow <= TICKS; tickNow++) {
+        stepped.advance(base + tickNow * KNX_CYCLIC_TICK, timerExpired);
+
+        if ((tickNow == gapEnd) || (tickNow == TICKS)) {
+            gapped.advance(base + tickNow * KNX_CYCLIC_TICK, gapTimerExpired);
+            if (memcmp(fireCount, gapFireCount, sizeof(fireCount)) != 0) diffs++;
+            g = (g + 1) % (sizeof(gaps) / sizeof(gaps[0]));
+            gapEnd += gaps[g];
+        }
+    }
+
+    CHECK_EQUAL(0, diffs);
+    CHECK_EQUAL(0, lateCount);
+}
+
+int main(void) {
+    mockReset();
+
+    // millis() stays put while a wheel is built, so it starts at the time read next
+    mockMicrosPerCall = 0;
+    testDueTicks();
+    testGaps();
+    mockMicrosPerCall = 4;
+
+    return knxTestResult("test_timer_wheel");
+}
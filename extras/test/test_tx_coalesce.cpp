@@ -0,0 +1,153 @@
+/*
+ *    test_tx_coalesce.cpp
+ *
+ *    Coalescing of pending telegrams: a newer value for the same target address,
+ *    command and priority replaces the pending one in its queue position, also if
+ *    the addresses share an index bucket or the payload grows, and the replaced
+ *    telegram is reported as dropped.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+typedef KnxTxQueue<KnxTxEntry, ACTIONS_QUEUE_SIZE, ACTIONS_QUEUE_ARENA_SIZE> Queue;
+
+// the same index bucket, see KnxTxQueue::getHash
+#define GROUP_A G_ADDR(1,0,1)
+#define GROUP_B G_ADDR(1,1,0x10)
+#define GROUP_C G_ADDR(1,0,2)
+
+static int confirmed;
+static int dropped;
+
+void telegramCompletedCallback(const KnxTxCompletion& completion) {
+    if (completion.status == KNX_TX_CONFIRMED) confirmed++;
+    if (completion.status == KNX_TX_DROPPED) dropped++;
+}
+
+static void makeEntry(KnxTxEntry& entry, word groupAddress, byte value, byte length, KnxCommand command, KnxPriority priority) {
+    byte payload[4] = { value, value, value, value };
+
+    entry.telegram.clearTelegram();
+    entry.telegram.setPriority(priority);
+    entry.telegram.setTargetAddress(groupAddress);
+    entry.telegram.setCommand(command);
+    entry.telegram.setPayload(payload, length);
+    entry.handle = value;
+    entry.enqueueTimeMicrosec = micros();
+}
+
+static void append(Queue& queue, word groupAddress, byte value, KnxTxQueueResult expected,
+                   KnxCommand command = KNX_COMMAND_VALUE_WRITE, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE, byte length = 1) {
+    KnxTxEntry entry;
+
+    makeEntry(entry, groupAddress, value, length, command, priority);
+    CHECK_EQUAL(expected, queue.append(entry));
+}
+
+static void checkPop(Queue& queue, word groupAddress, byte value) {
+    KnxTxEntry entry;
+
+    CHECK(queue.pop(entry));
+    CHECK_EQUAL(groupAddress, entry.getTargetAddress());
+    CHECK_EQUAL(value, entry.telegram.getRawByte(8));
+}
+
+// the newest value keeps the place of the first one, the replaced one is handed back
+static void testQueue(void) {
+    static Queue queue;
+    KnxTxEntry entry, replaced;
+
+    queue.setCoalescing(true);
+
+    append(queue, GROUP_A, 1, KNX_TX_QUEUE_APPENDED);
+    append(queue, GROUP_B, 2, KNX_TX_QUEUE_APPENDED);
+    append(queue, GROUP_C, 3, KNX_TX_QUEUE_APPENDED);
+
+    makeEntry(entry, GROUP_A, 4, 1, KNX_COMMAND_VALUE_WRITE, KNX_PRIORITY_NORMAL_VALUE);
+    CHECK_EQUAL(KNX_TX_QUEUE_COALESCED, queue.append(entry, &replaced));
+    CHECK_EQUAL(GROUP_A, replaced.getTargetAddress());
+    CHECK_EQUAL(1, replaced.handle);
+    append(queue, GROUP_B, 5, KNX_TX_QUEUE_COALESCED);
+
+    // a longer payload moves the telegram in the arena, not in the queue
+    append(queue, GROUP_B, 6, KNX_TX_QUEUE_COALESCED, KNX_COMMAND_VALUE_WRITE, KNX_PRIORITY_NORMAL_VALUE, 4);
+    CHECK_EQUAL(3, queue.getItemCount());
+
+    checkPop(queue, GROUP_A, 4);
+    checkPop(queue, GROUP_B, 6);
+    checkPop(queue, GROUP_C, 3);
+    CHECK(!queue.pop(entry));
+
+    // a telegram popped already is not replaced
+    append(queue, GROUP_A, 7, KNX_TX_QUEUE_APPENDED);
+    checkPop(queue, GROUP_A, 7);
+    append(queue, GROUP_A, 8, KNX_TX_QUEUE_APPENDED);
+    checkPop(queue, GROUP_A, 8);
+}
+
+// another command or priority is queued on its own, and nothing is coalesced when disabled
+static void testNoMatch(void) {
+    static Queue queue;
+    KnxTxEntry entry;
+
+    queue.setCoalescing(true);
+
+    append(queue, GROUP_A, 1, KNX_TX_QUEUE_APPENDED);
+    append(queue, GROUP_A, 2, KNX_TX_QUEUE_APPENDED, KNX_COMMAND_VALUE_RESPONSE);
+    append(queue, GROUP_A, 3, KNX_TX_QUEUE_APPENDED, KNX_COMMAND_VALUE_WRITE, KNX_PRIORITY_HIGH_VALUE);
+    CHECK_EQUAL(3, queue.getItemCount());
+
+    queue.setCoalescing(false);
+    append(queue, GROUP_A, 4, KNX_TX_QUEUE_APPENDED);
+    CHECK_EQUAL(4, queue.getItemCount());
+
+    checkPop(queue, GROUP_A, 3);
+    checkPop(queue, GROUP_A, 1);
+    checkPop(queue, GROUP_A, 2);
+    checkPop(queue, GROUP_A, 4);
+    CHECK(!queue.pop(entry));
+}
+
+// values written between two task calls for one group address send the last one only
+static void testSimpleKnx(void) {
+    int frames = mockFrameCount;
+
+    SimpleKnx.setTxCoalescing(true);
+
+    CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, SimpleKnx.groupWrite1ByteIntValue(false, GROUP_C, 1));
+    CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, SimpleKnx.groupWrite1ByteIntValue(false, GROUP_A, 1));
+    for (byte value = 2; value <= 10; value++) {
+        CHECK_EQUAL(KNX_TX_QUEUE_COALESCED, SimpleKnx.groupWrite1ByteIntValue(false, GROUP_C, value));
+    }
+
+    for (int i = 0; i < 500; i++) {
+        mockAdvance(200);
+        SimpleKnx.task();
+    }
+
+    CHECK_EQUAL(frames + 2, mockFrameCount);
+    CHECK_EQUAL(GROUP_C, (mockFrames[frames].data[3] << 8) | mockFrames[frames].data[4]);
+    CHECK_EQUAL(10, mockFrames[frames].data[8]);
+    CHECK_EQUAL(GROUP_A, (mockFrames[frames + 1].data[3] << 8) | mockFrames[frames + 1].data[4]);
+    CHECK_EQUAL(2, confirmed);
+    CHECK_EQUAL(9, dropped);
+
+    SimpleKnx.setTxCoalescing(false);
+}
+
+int main(void) {
+    mockReset();
+    SimpleKnx.init(Serial, P_ADDR(1,1,12));
+
+    testQueue();
+    testNoMatch();
+    testSimpleKnx();
+
+    return knxTestResult("test_tx_coalesce");
+}
@@ -0,0 +1,209 @@
+/*
+ *    test_tx_completion.cpp
+ *
+ *    Completion of queued telegrams: every handle is reported once, as confirmed,
+ *    failed or dropped, with its enqueue, start and done times on the simulated clock.
+ *    Handles skip KNX_TX_HANDLE_NONE when they wrap around.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+#define COMPLETIONS_MAX 300
+#define DONE_DELAY_MAX  2000 // us from the confirmation to the completion
+
+static KnxTxCompletion completions[COMPLETIONS_MAX];
+static int completionCount;
+static byte reported[256];
+
+void telegramCompletedCallback(const KnxTxCompletion& completion) {
+    if (completionCount < COMPLETIONS_MAX) completions[completionCount] = completion;
+    completionCount++;
+    reported[completion.handle]++;
+}
+
+static void startCompletions(void) {
+    completionCount = 0;
+    memset(reported, 0, sizeof(reported));
+}
+
+static void run(unsigned long microsec) {
+    unsigned long end = mockNow() + microsec;
+
+    while (mockNow() < end) {
+        mockAdvance(200);
+        SimpleKnx.task();
+    }
+}
+
+// write time of the first byte of the frame following the tx log entry first
+static unsigned long frameStart(int first) {
+    for (int i = first; i < mockTxCount; i++) {
+        if (mockTxLog[i].data == TPUART_DATA_START_CONTINUE_REQ) return mockTxLog[i].writeTime;
+    }
+
+    return 0;
+}
+
+// arrival time of the confirmation of frame, see the mock TPUART
+static unsigned long confirmTime(int frame) {
+    return mockFrames[frame].endTime + (mockFrames[frame].length + 3) * MOCK_BUS_CHARACTER_TIME;
+}
+
+// write time of the tx log entry after the end of frame
+static int txAfterFrame(int frame) {
+    int i = 0;
+
+    while ((i < mockTxCount) && (mockTxLog[i].sentTime <= mockFrames[frame].endTime)) i++;
+    return i;
+}
+
+// confirmed telegrams report when they were queued, handed to the TPUART and confirmed
+static void testConfirmed(void) {
+    KnxTxHandle handles[3];
+    unsigned long writeTimes[3];
+    int frames = mockFrameCount;
+    int firstTx = mockTxCount;
+
+    startCompletions();
+    for (byte i = 0; i < 3; i++) {
+        mockAdvance(5000);
+        writeTimes[i] = mockNow();
+        CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, SimpleKnx.groupWrite1ByteIntValue(false, G_ADDR(3, 0, i), i));
+        handles[i] = SimpleKnx.getLastTxHandle();
+        CHECK(handles[i] != KNX_TX_HANDLE_NONE);
+    }
+    CHECK(handles[0] != handles[1]);
+    CHECK(handles[1] != handles[2]);
+
+    run(500000);
+    CHECK_EQUAL(3, completionCount);
+    CHECK_EQUAL(frames + 3, mockFrameCount);
+
+    for (byte i = 0; i < 3; i++) {
+        KnxTxCompletion& c = completions[i];
+        unsigned long start = frameStart((i == 0) ? firstTx : txAfterFrame(frames + i - 1));
+
+        CHECK_EQUAL(handles[i], c.handle);
+        CHECK_EQUAL(1, reported[c.handle]);
+        CHECK_EQUAL(G_ADDR(3, 0, i), c.groupAddress);
+        CHECK_EQUAL(KNX_TX_CONFIRMED, c.status);
+
+        CHECK(c.enqueueTimeMicrosec <= writeTimes[i] + 100);
+        CHECK(writeTimes[i] - c.enqueueTimeMicrosec < KNX_TX_ENTRY_TIME_STEP);
+        CHECK_EQUAL(start, c.startTimeMicrosec);
+        CHECK(c.doneTimeMicrosec >= confirmTime(frames + i));
+        CHECK(c.doneTimeMicrosec - confirmTime(frames + i) < DONE_DELAY_MAX);
+    }
+}
+
+// a telegram repeated without confirmation fails once, after its last repetition
+static void testFailed(void) {
+    static const byte confirms[] = { TPUART_DATA_CONFIRM_FAILED, TPUART_DATA_CONFIRM_FAILED, TPUART_DATA_CONFIRM_FAILED };
+    int frames = mockFrameCount;
+    int firstTx = mockTxCount;
+    byte failedBefore = SimpleKnx.getTxFailedCount();
+
+    startCompletions();
+    mockSetConfirms(confirms, sizeof(confirms));
+    SimpleKnx.groupWriteBool(false, G_ADDR(3, 1, 1), true);
+    run(3000000);
+
+    CHECK_EQUAL(frames + KNX_TX_RETRIES + 1, mockFrameCount);
+    CHECK_EQUAL(1, completionCount);
+    CHECK_EQUAL(KNX_TX_FAILED, completions[0].status);
+    CHECK_EQUAL(failedBefore + 1, SimpleKnx.getTxFailedCount());
+    CHECK_EQUAL(frameStart(firstTx), completions[0].startTimeMicrosec);
+    CHECK(completions[0].doneTimeMicrosec >= confirmTime(mockFrameCount - 1));
+    CHECK(completions[0].doneTimeMicrosec - confirmTime(mockFrameCount - 1) < DONE_DELAY_MAX);
+}
+
+// dropped telegrams are reported at once and never started, refused ones have no handle
+static void testDropped(void) {
+    KnxTxHandle coalesced, newest;
+    int rejected = 0, twice = 0;
+
+    startCompletions();
+
+    SimpleKnx.setTxCoalescing(true);
+    SimpleKnx.groupWrite1ByteIntValue(false, G_ADDR(3, 2, 1), 1);
+    coalesced = SimpleKnx.getLastTxHandle();
+    CHECK_EQUAL(KNX_TX_QUEUE_COALESCED, SimpleKnx.groupWrite1ByteIntValue(false, G_ADDR(3, 2, 1), 2));
+    newest = SimpleKnx.getLastTxHandle();
+    SimpleKnx.setTxCoalescing(false);
+
+    CHECK_EQUAL(1, completionCount);
+    CHECK_EQUAL(coalesced, completions[0].handle);
+    CHECK_EQUAL(KNX_TX_DROPPED, completions[0].status);
+    CHECK_EQUAL(completions[0].doneTimeMicrosec, completions[0].startTimeMicrosec);
+    CHECK(completions[0].enqueueTimeMicrosec <= completions[0].startTimeMicrosec);
+
+    // the queue is full of normal telegrams, they cannot replace each other
+    for (word i = 0; i < 2 * ACTIONS_QUEUE_SIZE; i++) {
+        if (SimpleKnx.groupWrite1ByteIntValue(false, G_ADDR(3, 3, i), i) == KNX_TX_QUEUE_REJECTED) {
+            CHECK_EQUAL(KNX_TX_HANDLE_NONE, SimpleKnx.getLastTxHandle());
+            rejected++;
+        }
+    }
+    CHECK(rejected > 0);
+    CHECK_EQUAL(1, completionCount);
+
+    // the alarm drops the oldest normal one, the value written over the first one
+    CHECK_EQUAL(KNX_TX_QUEUE_REPLACED, SimpleKnx.groupWriteBool(false, G_ADDR(5, 0, 1), true, KNX_PRIORITY_ALARM_VALUE));
+    CHECK_EQUAL(2, completionCount);
+    CHECK_EQUAL(KNX_TX_DROPPED, completions[1].status);
+    CHECK_EQUAL(newest, completions[1].handle);
+    CHECK_EQUAL(G_ADDR(3, 2, 1), completions[1].groupAddress);
+
+    run(5000000);
+    for (int h = 0; h < 256; h++) {
+        if (reported[h] > 1) twice++;
+    }
+    CHECK_EQUAL(0, twice);
+    CHECK_EQUAL(0, reported[KNX_TX_HANDLE_NONE]);
+    // both values of 3/2/1, the queued normal ones and the alarm
+    CHECK_EQUAL(2 + (2 * ACTIONS_QUEUE_SIZE - rejected) + 1, completionCount);
+}
+
+// handles count up and skip KNX_TX_HANDLE_NONE
+static void testHandleWrap(void) {
+    KnxTxHandle last = KNX_TX_HANDLE_NONE;
+    int dropped;
+
+    startCompletions();
+    SimpleKnx.setTxCoalescing(true);
+
+    for (int i = 0; i < 300; i++) {
+        SimpleKnx.groupWrite1ByteIntValue(false, G_ADDR(3, 4, 1), i);
+        CHECK(SimpleKnx.getLastTxHandle() != KNX_TX_HANDLE_NONE);
+        CHECK(SimpleKnx.getLastTxHandle() != last);
+        last = SimpleKnx.getLastTxHandle();
+    }
+    dropped = completionCount;
+
+    SimpleKnx.setTxCoalescing(false);
+    run(200000);
+
+    CHECK_EQUAL(299, dropped);
+    CHECK_EQUAL(300, completionCount);
+    CHECK_EQUAL(last, completions[COMPLETIONS_MAX - 1].handle);
+    CHECK_EQUAL(KNX_TX_CONFIRMED, completions[COMPLETIONS_MAX - 1].status);
+}
+
+int main(void) {
+    mockReset();
+    SimpleKnx.init(Serial, P_ADDR(1,1,12));
+    run(10000);
+
+    testConfirmed();
+    testFailed();
+    testDropped();
+    testHandleWrap();
+
+    return knxTestResult("test_tx_completion");
+}
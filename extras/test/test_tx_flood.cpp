@@ -0,0 +1,125 @@
+/*
+ *    test_tx_flood.cpp
+ *
+ *    Transmit queue under a flood of normal priority writes: with the default
+ *    KNX_TX_QUEUE_EVICT policy no alarm telegram is ever lost.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+#define ALARM_GROUP 5
+
+static int alarmsQueued;
+static int alarmsConfirmed;
+static int alarmsLost;
+static int normalsConfirmed;
+static int normalsDropped;
+
+void telegramCompletedCallback(const KnxTxCompletion& completion) {
+    boolean alarm = ((completion.groupAddress >> 11) == ALARM_GROUP);
+
+    if (completion.status == KNX_TX_CONFIRMED) {
+        if (alarm) alarmsConfirmed++; else normalsConfirmed++;
+    } else {
+        if (alarm) alarmsLost++; else normalsDropped++;
+    }
+}
+
+static void resetCounts(void) {
+    alarmsQueued = alarmsConfirmed = alarmsLost = 0;
+    normalsConfirmed = normalsDropped = 0;
+}
+
+static void run(unsigned long microsec) {
+    unsigned long end = mockNow() + microsec;
+
+    while (mockNow() < end) {
+        mockAdvance(200);
+        SimpleKnx.task();
+    }
+}
+
+static void writeAlarm(word index) {
+    KnxTxQueueResult result = SimpleKnx.groupWriteBool(false, G_ADDR(ALARM_GROUP, 0, index), true, KNX_PRIORITY_ALARM_VALUE);
+
+    CHECK(result != KNX_TX_QUEUE_REJECTED);
+    if (result != KNX_TX_QUEUE_REJECTED) alarmsQueued++;
+}
+
+// the queue is full of normal telegrams when the alarms come
+static void testFullQueue(void) {
+    resetCounts();
+
+    for (word i = 0; i < 100; i++) SimpleKnx.groupWrite1ByteIntValue(false, G_ADDR(1, 0, i), i);
+    CHECK(SimpleKnx.getTxQueueDropCount() > 0);
+
+    for (word i = 0; i < 10; i++) writeAlarm(i);
+
+    run(2000000);
+
+    CHECK_EQUAL(10, alarmsQueued);
+    CHECK_EQUAL(10, alarmsConfirmed);
+    CHECK_EQUAL(0, alarmsLost);
+    CHECK(normalsDropped > 0);
+}
+
+// normal telegrams are written far faster than the bus takes them, alarms come in between
+// and behind them, when the queue is full already
+static void testFlood(void) {
+    int rejected = 0;
+
+    resetCounts();
+
+    for (word round = 0; round < 20; round++) {
+        for (word i = 0; i < 30; i++) {
+            if (SimpleKnx.groupWrite2ByteIntValue(false, G_ADDR(1, round & 7, i), round) == KNX_TX_QUEUE_REJECTED) rejected++;
+            if (i == 10) writeAlarm(2 * round);
+        }
+        writeAlarm(2 * round + 1);
+        run(1000);
+    }
+
+    run(2000000);
+
+    CHECK_EQUAL(40, alarmsQueued);
+    CHECK_EQUAL(40, alarmsConfirmed);
+    CHECK_EQUAL(0, alarmsLost);
+    CHECK(rejected > 0);
+    CHECK(normalsDropped > 0);
+    CHECK(normalsConfirmed > 0);
+}
+
+// an alarm written last is sent first
+static void testAlarmFirst(void) {
+    int framesBefore = mockFrameCount;
+
+    resetCounts();
+
+    for (word i = 0; i < 10; i++) SimpleKnx.groupWrite1ByteIntValue(false, G_ADDR(1, 1, i), i);
+    writeAlarm(99);
+    run(2000000);
+
+    CHECK_EQUAL(framesBefore + 11, mockFrameCount);
+    CHECK_EQUAL(G_ADDR(ALARM_GROUP, 0, 99), (mockFrames[framesBefore].data[3] << 8) | mockFrames[framesBefore].data[4]);
+    CHECK_EQUAL(1, alarmsConfirmed);
+    CHECK_EQUAL(10, normalsConfirmed);
+}
+
+int main(void) {
+    mockReset();
+    SimpleKnx.init(Serial, P_ADDR(1,1,12));
+
+    testFullQueue();
+    testFlood();
+
+    mockReset();
+    testAlarmFirst();
+
+    return knxTestResult("test_tx_flood");
+}
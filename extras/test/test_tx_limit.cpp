@@ -0,0 +1,180 @@
+/*
+ *    test_tx_limit.cpp
+ *
+ *    Token bucket rate limit on the simulated clock: the burst is sent back to back
+ *    and then the rate, buckets of single group addresses are independent of each
+ *    other, and a telegram waiting for tokens is counted once.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+#define LIMITED_A G_ADDR(3,0,1)
+#define LIMITED_B G_ADDR(3,0,2)
+#define FREE      G_ADDR(3,0,3)
+
+static void run(unsigned long microsec) {
+    unsigned long end = mockNow() + microsec;
+
+    while (mockNow() < end) {
+        mockAdvance(200);
+        SimpleKnx.task();
+    }
+}
+
+// sends whenever the global bucket allows between from and to ms, returns the telegrams sent
+static int sendAll(KnxTxLimiter& limiter, unsigned long from, unsigned long to) {
+    int sent = 0;
+
+    for (unsigned long t = from; t <= to; t++) {
+        limiter.refill(t);
+        while (limiter.isAllowed()) {
+            limiter.consume(FREE);
+            sent++;
+        }
+    }
+
+    return sent;
+}
+
+// the burst goes out at once, after it the rate, and the bucket never holds more than the burst
+static void testBurst(void) {
+    KnxTxLimiter limiter;
+    unsigned long base = millis();
+
+    limiter.setLimit(10, 5);
+    CHECK_EQUAL(5, sendAll(limiter, base, base));
+    CHECK(!limiter.isAllowed());
+    CHECK(!limiter.isAllowed());
+    CHECK_EQUAL(1, limiter.getThrottledCount());
+
+    // a telegram per 100 ms
+    limiter.refill(base + 99);
+    CHECK(!limiter.isAllowed());
+    limiter.refill(base + 100);
+    CHECK(limiter.isAllowed());
+    limiter.consume(FREE);
+    CHECK_EQUAL(1, limiter.getThrottledCount());
+    CHECK(!limiter.isAllowed());
+    CHECK_EQUAL(2, limiter.getThrottledCount());
+
+    CHECK_EQUAL(10, sendAll(limiter, base + 101, base + 1100));
+
+    // idle for a long time, still only the burst
+    CHECK_EQUAL(5, sendAll(limiter, base + 60000, base + 60000));
+}
+
+// bursts above 32 telegrams, up to the 65 the tokens can hold
+static void testLargeBurst(void) {
+    KnxTxLimiter limiter;
+    unsigned long base = millis();
+
+    limiter.setLimit(50, 40);
+    CHECK_EQUAL(40, sendAll(limiter, base, base));
+    CHECK_EQUAL(50, sendAll(limiter, base + 1, base + 1000));
+
+    limiter.setLimit(50, 65);
+    CHECK_EQUAL(65, sendAll(limiter, base + 1000, base + 1000));
+
+    limiter.setLimit(50, 200);
+    CHECK_EQUAL(65, sendAll(limiter, base + 1000, base + 1000));
+    CHECK_EQUAL(65, sendAll(limiter, base + 60000, base + 60000));
+}
+
+// each limited group address has its own bucket and counter, others are not limited
+static void testGroupAddresses(void) {
+    KnxTxLimiter limiter;
+    unsigned long base = millis();
+
+    CHECK(limiter.setLimit(LIMITED_A, 1, 2));
+    CHECK(limiter.setLimit(LIMITED_B, 2, 1));
+    for (byte i = 2; i < KNX_TX_LIMIT_GA_SIZE; i++) CHECK(limiter.setLimit(G_ADDR(4, 0, i), 1, 1));
+    CHECK(!limiter.setLimit(G_ADDR(4, 1, 0), 1, 1));
+    CHECK(limiter.setLimit(LIMITED_B, 2, 1));
+    limiter.refill(base);
+
+    for (byte i = 0; i < 2; i++) {
+        CHECK(limiter.isAllowed(LIMITED_A));
+        limiter.consume(LIMITED_A);
+    }
+    CHECK(!limiter.isAllowed(LIMITED_A));
+    CHECK(limiter.isAllowed(LIMITED_B));
+    limiter.consume(LIMITED_B);
+    CHECK(!limiter.isAllowed(LIMITED_B));
+
+    for (byte i = 0; i < 100; i++) {
+        CHECK(limiter.isAllowed(FREE));
+        limiter.consume(FREE);
+    }
+    CHECK(limiter.isAllowed());
+
+    CHECK_EQUAL(1, limiter.getThrottledCount(LIMITED_A));
+    CHECK_EQUAL(1, limiter.getThrottledCount(LIMITED_B));
+    CHECK_EQUAL(0, limiter.getThrottledCount(FREE));
+    CHECK_EQUAL(0, limiter.getThrottledCount());
+
+    // B refills twice as fast as A
+    limiter.refill(base + 500);
+    CHECK(!limiter.isAllowed(LIMITED_A));
+    CHECK(limiter.isAllowed(LIMITED_B));
+    limiter.consume(LIMITED_B);
+    limiter.refill(base + 1000);
+    CHECK(limiter.isAllowed(LIMITED_A));
+    CHECK(limiter.isAllowed(LIMITED_B));
+}
+
+// telegrams leave the queue at the rate, a limited group address waits behind the others
+static void testSimpleKnx(void) {
+    int frames = mockFrameCount;
+
+    SimpleKnx.setTxRateLimit(5, 2);
+    for (word i = 0; i < 6; i++) SimpleKnx.groupWriteBool(false, G_ADDR(1, 0, i), true);
+
+    run(3000000);
+    CHECK_EQUAL(frames + 6, mockFrameCount);
+    CHECK(mockFrames[frames + 1].endTime - mockFrames[frames].endTime < 100000);
+    // the bucket refills while the burst is sent, so the third one waits for the first one only
+    CHECK(mockFrames[frames + 2].endTime - mockFrames[frames].endTime >= 190000);
+    for (int i = frames + 3; i < mockFrameCount; i++) {
+        CHECK(mockFrames[i].endTime - mockFrames[i - 1].endTime >= 190000);
+        CHECK(mockFrames[i].endTime - mockFrames[i - 1].endTime < 250000);
+    }
+    CHECK(SimpleKnx.getTxThrottledCount() >= 4);
+
+    SimpleKnx.setTxRateLimit(0, 1);
+    CHECK(SimpleKnx.setTxRateLimit(LIMITED_A, 1, 1));
+    frames = mockFrameCount;
+    for (word i = 0; i < 3; i++) {
+        SimpleKnx.groupWrite1ByteIntValue(false, LIMITED_A, i);
+        SimpleKnx.groupWrite1ByteIntValue(false, G_ADDR(1, 1, i), i);
+    }
+
+    run(500000);
+    CHECK_EQUAL(frames + 4, mockFrameCount);
+    CHECK_EQUAL(LIMITED_A, (mockFrames[frames].data[3] << 8) | mockFrames[frames].data[4]);
+    for (int i = frames + 1; i < mockFrameCount; i++) {
+        CHECK(LIMITED_A != ((mockFrames[i].data[3] << 8) | mockFrames[i].data[4]));
+    }
+    CHECK_EQUAL(1, SimpleKnx.getTxThrottledCount(LIMITED_A));
+
+    run(2000000);
+    CHECK_EQUAL(frames + 6, mockFrameCount);
+    CHECK_EQUAL(2, SimpleKnx.getTxThrottledCount(LIMITED_A));
+}
+
+int main(void) {
+    mockReset();
+    SimpleKnx.init(Serial, P_ADDR(1,1,12));
+
+    testBurst();
+    testLargeBurst();
+    testGroupAddresses();
+    testSimpleKnx();
+
+    return knxTestResult("test_tx_limit");
+}
@@ -0,0 +1,154 @@
+/*
+ *    test_tx_next.cpp
+ *
+ *    The next telegram is prepared while the current one is on the bus: it is stamped
+ *    when handed over, starts right after the confirmation or final failure of the
+ *    current one without another call, and is dropped by a reset.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+#define PHYSICAL_ADDR  P_ADDR(1,1,12)
+#define NEXT_DELAY_MAX 1000 // us from the confirmation to the first byte of the next telegram
+
+static const word groupAddresses[] = { G_ADDR(2,7,1) };
+static KnxTpUart *tpuart;
+static int sent, failed;
+static KnxTelegram current, next, third;
+
+static void events(KnxTpUartEvent event) {
+    if (event == TPUART_EVENT_KNX_TELEGRAM_SENT) sent++;
+    if (event == TPUART_EVENT_KNX_TELEGRAM_SEND_FAILED) failed++;
+}
+
+static void runUntil(unsigned long timeMicrosec) {
+    while (mockNow() < timeMicrosec) {
+        mockAdvance(100);
+        tpuart->rxTask();
+        tpuart->txTask();
+    }
+}
+
+static void makeTelegram(KnxTelegram& t, word groupAddress, byte value) {
+    t.clearTelegram();
+    t.setTargetAddress(groupAddress);
+    t.setCommand(KNX_COMMAND_VALUE_WRITE);
+    t.setPayload(&value, 1);
+}
+
+static void startTpUart(void) {
+    mockReset();
+    delete tpuart;
+    tpuart = new KnxTpUart(Serial, PHYSICAL_ADDR, groupAddresses, 1);
+    sent = failed = 0;
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->reset());
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->setEvtCallback(events));
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->init());
+    runUntil(mockNow() + 5000);
+
+    makeTelegram(current, G_ADDR(3,0,1), 1);
+    makeTelegram(next, G_ADDR(3,0,2), 2);
+    makeTelegram(third, G_ADDR(3,0,3), 3);
+}
+
+// write time of the first byte of the frame following the tx log entry first
+static unsigned long frameStart(int first) {
+    for (int i = first; i < mockTxCount; i++) {
+        if (mockTxLog[i].data == TPUART_DATA_START_CONTINUE_REQ) return mockTxLog[i].writeTime;
+    }
+
+    return 0;
+}
+
+// arrival time of the confirmation of frame, see the mock TPUART
+static unsigned long confirmTime(int frame) {
+    return mockFrames[frame].endTime + (mockFrames[frame].length + 3) * MOCK_BUS_CHARACTER_TIME;
+}
+
+static word frameTarget(int frame) {
+    return (mockFrames[frame].data[3] << 8) | mockFrames[frame].data[4];
+}
+
+// the prepared telegram is complete when handed over, and goes out right after the confirmation
+static void testPrepared(void) {
+    byte xorSum = 0;
+    int txBefore;
+
+    startTpUart();
+
+    CHECK_EQUAL(KNX_TPUART_ERROR, tpuart->sendNextTelegram(next));
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->sendTelegram(current));
+    CHECK(tpuart->isReadyForNext());
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->sendNextTelegram(next));
+    CHECK(!tpuart->isReadyForNext());
+    CHECK_EQUAL(KNX_TPUART_ERROR, tpuart->sendNextTelegram(third));
+
+    CHECK_EQUAL(PHYSICAL_ADDR, next.getSourceAddress());
+    for (byte i = 0; i < next.getTelegramLength(); i++) xorSum ^= next.getRawByte(i);
+    CHECK_EQUAL(0xFF, xorSum);
+
+    // nothing but the tasks run from here on
+    runUntil(mockNow() + 20000);
+    CHECK_EQUAL(1, mockFrameCount);
+    txBefore = mockTxCount;
+
+    runUntil(mockNow() + 60000);
+    CHECK_EQUAL(2, mockFrameCount);
+    CHECK_EQUAL(2, sent);
+    CHECK_EQUAL(G_ADDR(3,0,1), frameTarget(0));
+    CHECK_EQUAL(G_ADDR(3,0,2), frameTarget(1));
+    CHECK(frameStart(txBefore) > confirmTime(0));
+    CHECK(frameStart(txBefore) - confirmTime(0) < NEXT_DELAY_MAX);
+    CHECK(tpuart->isFreeToSend());
+}
+
+// the prepared telegram waits for the repetitions of the current one and follows its failure
+static void testAfterFailure(void) {
+    static const byte confirms[] = { TPUART_DATA_CONFIRM_FAILED, TPUART_DATA_CONFIRM_FAILED, TPUART_DATA_CONFIRM_FAILED };
+
+    startTpUart();
+    mockSetConfirms(confirms, sizeof(confirms));
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->sendTelegram(current, 2));
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->sendNextTelegram(next));
+    runUntil(mockNow() + 2000000);
+
+    CHECK_EQUAL(4, mockFrameCount);
+    for (int i = 0; i < 3; i++) CHECK_EQUAL(G_ADDR(3,0,1), frameTarget(i));
+    CHECK_EQUAL(G_ADDR(3,0,2), frameTarget(3));
+    CHECK_EQUAL(1, failed);
+    CHECK_EQUAL(1, sent);
+}
+
+// a reset drops the prepared telegram with the current one
+static void testReset(void) {
+    startTpUart();
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->sendTelegram(current));
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->sendNextTelegram(next));
+    runUntil(mockNow() + 2000);
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->reset());
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->init());
+    runUntil(mockNow() + 100000);
+
+    CHECK_EQUAL(0, mockFrameCount);
+    CHECK(tpuart->isFreeToSend());
+}
+
+int main(void) {
+    testPrepared();
+    testAfterFailure();
+    testReset();
+
+    delete tpuart;
+
+    return knxTestResult("test_tx_next");
+}
@@ -0,0 +1,118 @@
+/*
+ *    test_tx_queue.cpp
+ *
+ *    Compact storage of queued telegrams: capacity of the default queue, telegrams
+ *    of every payload length, priority and command come back unchanged, and the
+ *    enqueue time comes back rounded down to KNX_TX_ENTRY_TIME_STEP.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+typedef KnxTxQueue<KnxTxEntry, ACTIONS_QUEUE_SIZE, ACTIONS_QUEUE_ARENA_SIZE> Queue;
+
+#define FORMER_QUEUE_SIZE 16 // KnxTelegram slots of the former queue, 368 bytes
+
+static void makeEntry(KnxTxEntry& entry, word groupAddress, byte length, KnxPriority priority, KnxCommand command) {
+    byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE];
+
+    for (byte i = 0; i < KNX_TELEGRAM_PAYLOAD_MAX_SIZE; i++) payload[i] = 0xA5 ^ (17 * i) ^ length;
+
+    entry.telegram.clearTelegram();
+    entry.telegram.setPriority(priority);
+    entry.telegram.setTargetAddress(groupAddress);
+    entry.telegram.setCommand(command);
+    entry.telegram.setPayload(payload, length);
+    entry.handle = byte(groupAddress) | 1;
+    entry.enqueueTimeMicrosec = micros();
+}
+
+// counts the telegrams of payload length fitting into an empty queue
+static int capacity(byte length) {
+    static Queue queue;
+    KnxTxEntry entry;
+    int count = 0;
+
+    while (queue.pop(entry)) {}
+    queue.setPolicy(KNX_TX_QUEUE_REJECT);
+
+    for (word i = 0; i < 255; i++) {
+        makeEntry(entry, G_ADDR(1, 0, i), length, KNX_PRIORITY_NORMAL_VALUE, KNX_COMMAND_VALUE_WRITE);
+        if (queue.append(entry) == KNX_TX_QUEUE_REJECTED) break;
+        count++;
+    }
+
+    return count;
+}
+
+// per byte of RAM the default queue holds more than twice the DPT 1 telegrams of the former one
+static void testCapacity(void) {
+    int dpt1 = capacity(0);
+    int dpt5 = capacity(1);
+    int dpt9 = capacity(2);
+
+    printf("DPT 1: %d, DPT 5: %d, DPT 9: %d telegrams in %u bytes\n", dpt1, dpt5, dpt9, (unsigned)sizeof(Queue));
+
+    CHECK(dpt1 * sizeof(KnxTelegram) >= 2 * sizeof(Queue));
+    CHECK(dpt1 >= 2 * FORMER_QUEUE_SIZE);
+    CHECK(dpt5 >= 2 * FORMER_QUEUE_SIZE - 2);
+    CHECK(dpt9 >= FORMER_QUEUE_SIZE + 12);
+}
+
+// popped telegrams have the same bytes as the appended ones
+static void testRoundTrip(void) {
+    static const KnxPriority priorities[] = { KNX_PRIORITY_SYSTEM_VALUE, KNX_PRIORITY_ALARM_VALUE, KNX_PRIORITY_HIGH_VALUE, KNX_PRIORITY_NORMAL_VALUE };
+    static const KnxCommand commands[] = { KNX_COMMAND_VALUE_READ, KNX_COMMAND_VALUE_RESPONSE, KNX_COMMAND_VALUE_WRITE, KNX_COMMAND_MEMORY_WRITE };
+    static Queue queue;
+    KnxTxEntry entry, popped;
+
+    for (byte length = 0; length <= KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 2; length++) {
+        for (byte p = 0; p < 4; p++) {
+            for (byte c = 0; c < 4; c++) {
+                makeEntry(entry, G_ADDR(31, 7, 200 + length), length, priorities[p], commands[c]);
+
+                CHECK_EQUAL(KNX_TX_QUEUE_APPENDED, queue.append(entry));
+                CHECK(queue.pop(popped));
+                CHECK_EQUAL(entry.getStoredSize(), popped.getStoredSize());
+                CHECK_EQUAL(entry.handle, popped.handle);
+                CHECK_EQUAL(entry.telegram.getTelegramLength(), popped.telegram.getTelegramLength());
+                for (byte i = 0; i < entry.telegram.getTelegramLength(); i++) {
+                    CHECK_EQUAL(entry.telegram.getRawByte(i), popped.telegram.getRawByte(i));
+                }
+            }
+        }
+    }
+}
+
+// the enqueue time loses its lowest bits only
+static void testEnqueueTime(void) {
+    static const unsigned long ages[] = { 0, 1, 1023, 1024, 50000, 1000000, 60000000 };
+    static Queue queue;
+    KnxTxEntry entry, popped;
+
+    for (byte i = 0; i < sizeof(ages) / sizeof(ages[0]); i++) {
+        mockAdvance(777);
+        makeEntry(entry, G_ADDR(1, 1, 1), 0, KNX_PRIORITY_NORMAL_VALUE, KNX_COMMAND_VALUE_WRITE);
+        queue.append(entry);
+        mockAdvance(ages[i]);
+        CHECK(queue.pop(popped));
+
+        CHECK(popped.enqueueTimeMicrosec <= entry.enqueueTimeMicrosec);
+        CHECK(entry.enqueueTimeMicrosec - popped.enqueueTimeMicrosec < KNX_TX_ENTRY_TIME_STEP);
+    }
+}
+
+int main(void) {
+    mockReset();
+
+    testCapacity();
+    testRoundTrip();
+    testEnqueueTime();
+
+    return knxTestResult("test_tx_queue");
+}
@@ -0,0 +1,199 @@
+/*
+ *    test_tx_retry.cpp
+ *
+ *    Repetition of telegrams the TPUART does not confirm, on the simulated clock:
+ *    repeat flag, the doubling backoff on an idle bus and the final failure.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+#define CONFIRM_FAILED   TPUART_DATA_CONFIRM_FAILED
+#define CONFIRM_SUCCESS  TPUART_DATA_CONFIRM_SUCCESS
+#define CONFIRM_NONE     0
+#define REPEAT_FLAG      0x20 // cleared in the control field of a repetition
+
+static const word groupAddresses[] = { G_ADDR(2,7,1) };
+static KnxTpUart *tpuart;
+static int sent, failed;
+static KnxTelegram telegram;
+static int firstTx;
+
+static void events(KnxTpUartEvent event) {
+    if (event == TPUART_EVENT_KNX_TELEGRAM_SENT) sent++;
+    if (event == TPUART_EVENT_KNX_TELEGRAM_SEND_FAILED) failed++;
+}
+
+static void runUntil(unsigned long timeMicrosec) {
+    while (mockNow() < timeMicrosec) {
+        mockAdvance(100);
+        tpuart->rxTask();
+        tpuart->txTask();
+    }
+}
+
+static void startTpUart(void) {
+    byte value = 0x55;
+
+    mockReset();
+    delete tpuart;
+    tpuart = new KnxTpUart(Serial, P_ADDR(1,1,12), groupAddresses, 1);
+    sent = failed = 0;
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->reset());
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->setEvtCallback(events));
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->init());
+    runUntil(mockNow() + 5000);
+
+    telegram.clearTelegram();
+    telegram.setTargetAddress(G_ADDR(3,1,1));
+    telegram.setCommand(KNX_COMMAND_VALUE_WRITE);
+    telegram.setPayload(&value, 1);
+    firstTx = mockTxCount;
+}
+
+// time the first byte of an attempt was written to the serial, ACK services in between are skipped
+static unsigned long attemptStart(int attempt) {
+    int i = firstTx;
+
+    while (i < mockTxCount) {
+        byte data = mockTxLog[i].data;
+
+        if ((data == TPUART_RX_ACK_SERVICE_ADDRESSED) || (data == TPUART_RX_ACK_SERVICE_NOT_ADDRESSED) ||
+            (data == TPUART_RX_ACK_SERVICE_BUSY)) {
+            i++;
+            continue;
+        }
+
+        if ((data == TPUART_DATA_START_CONTINUE_REQ) && (attempt-- == 0)) return mockTxLog[i].writeTime;
+        i += 2;
+    }
+
+    return 0;
+}
+
+// time the last byte of an attempt was written to the serial
+static unsigned long attemptEnd(int attempt) {
+    return attemptStart(attempt) + (telegram.getTelegramLength() - 1) * 2 * MOCK_SERIAL_BYTE_TIME;
+}
+
+// time the TPUART answered an attempt
+static unsigned long attemptConfirm(int attempt) {
+    return mockFrames[attempt].endTime + (mockFrames[attempt].length + 3) * MOCK_BUS_CHARACTER_TIME;
+}
+
+// repetitions carry the repeat flag and wait the doubling backoff
+static void testRepeatAndBackoff(void) {
+    static const byte confirms[] = { CONFIRM_FAILED, CONFIRM_FAILED, CONFIRM_SUCCESS };
+
+    startTpUart();
+    mockSetConfirms(confirms, 3);
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->sendTelegram(telegram, 2));
+    runUntil(mockNow() + 500000);
+
+    CHECK_EQUAL(1, sent);
+    CHECK_EQUAL(0, failed);
+    CHECK_EQUAL(3, mockFrameCount);
+    CHECK(mockFrames[0].data[0] & REPEAT_FLAG);
+    CHECK(!(mockFrames[1].data[0] & REPEAT_FLAG));
+    CHECK(!(mockFrames[2].data[0] & REPEAT_FLAG));
+    CHECK(tpuart->isFreeToSend());
+
+    // the backoff runs from the failure, one loop late at most
+    CHECK(attemptStart(1) - attemptConfirm(0) >= KNX_TX_RETRY_BACKOFF * 1000UL);
+    CHECK(attemptStart(1) - attemptConfirm(0) <= KNX_TX_RETRY_BACKOFF * 1000UL + 1000);
+    CHECK(attemptStart(2) - attemptConfirm(1) >= 2 * KNX_TX_RETRY_BACKOFF * 1000UL);
+    CHECK(attemptStart(2) - attemptConfirm(1) <= 2 * KNX_TX_RETRY_BACKOFF * 1000UL + 1000);
+}
+
+// the backoff doubles up to KNX_TX_RETRY_BACKOFF_MAX, then the failure is reported once
+static void testGiveUp(void) {
+    static const byte confirms[] = { CONFIRM_FAILED, CONFIRM_FAILED, CONFIRM_FAILED, CONFIRM_FAILED, CONFIRM_FAILED, CONFIRM_FAILED };
+    unsigned long backoff = KNX_TX_RETRY_BACKOFF;
+
+    startTpUart();
+    mockSetConfirms(confirms, 6);
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->sendTelegram(telegram, 5));
+    runUntil(mockNow() + 2000000);
+
+    CHECK_EQUAL(0, sent);
+    CHECK_EQUAL(1, failed);
+    CHECK_EQUAL(6, mockFrameCount);
+    CHECK(tpuart->isFreeToSend());
+
+    for (int attempt = 1; attempt < 6; attempt++) {
+        unsigned long wait = attemptStart(attempt) - attemptConfirm(attempt - 1);
+
+        CHECK(wait >= backoff * 1000);
+        CHECK(wait <= backoff * 1000 + 1000);
+        backoff = min(2 * backoff, (unsigned long)KNX_TX_RETRY_BACKOFF_MAX);
+    }
+}
+
+// without an answer of the TPUART the telegram is repeated after KNX_TX_TIMEOUT
+static void testTimeout(void) {
+    static const byte confirms[] = { CONFIRM_NONE, CONFIRM_SUCCESS };
+
+    startTpUart();
+    mockSetConfirms(confirms, 2);
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->sendTelegram(telegram, 2));
+    runUntil(mockNow() + 2000000);
+
+    CHECK_EQUAL(1, sent);
+    CHECK_EQUAL(2, mockFrameCount);
+
+    // the timeout runs from the last byte written, in milliseconds
+    CHECK(attemptStart(1) - attemptEnd(0) >= (KNX_TX_TIMEOUT + KNX_TX_RETRY_BACKOFF - 1) * 1000UL);
+    CHECK(attemptStart(1) - attemptEnd(0) <= (KNX_TX_TIMEOUT + KNX_TX_RETRY_BACKOFF + 2) * 1000UL);
+}
+
+// traffic on the bus during the backoff restarts the wait
+static void testBusyBus(void) {
+    static const byte confirms[] = { CONFIRM_FAILED, CONFIRM_SUCCESS };
+    KnxTelegram other;
+    byte raw[KNX_TELEGRAM_MAX_SIZE];
+    byte value = 1;
+    unsigned long end;
+
+    startTpUart();
+    mockSetConfirms(confirms, 2);
+
+    other.setSourceAddress(P_ADDR(1,1,5));
+    other.setTargetAddress(G_ADDR(4,0,1));
+    other.setCommand(KNX_COMMAND_VALUE_WRITE);
+    other.setPayload(&value, 1);
+    other.updateChecksum();
+    for (byte i = 0; i < other.getTelegramLength(); i++) raw[i] = other.getRawByte(i);
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->sendTelegram(telegram, 2));
+    runUntil(mockNow() + 30000);
+    CHECK_EQUAL(1, mockFrameCount);
+
+    // a frame of another device ends 10 ms into the backoff
+    end = mockRxFrame(raw, other.getTelegramLength(), attemptConfirm(0) + 10000 - (other.getTelegramLength() - 1) * MOCK_BUS_CHARACTER_TIME);
+    runUntil(mockNow() + 500000);
+
+    CHECK_EQUAL(1, sent);
+    CHECK_EQUAL(2, mockFrameCount);
+    CHECK(attemptStart(1) - end >= KNX_TX_RETRY_BACKOFF * 1000UL);
+    CHECK(attemptStart(1) - end <= KNX_TX_RETRY_BACKOFF * 1000UL + 1000);
+}
+
+int main(void) {
+    testRepeatAndBackoff();
+    testGiveUp();
+    testTimeout();
+    testBusyBus();
+
+    delete tpuart;
+
+    return knxTestResult("test_tx_retry");
+}
@@ -0,0 +1,140 @@
+/*
+ *    test_tx_uart.cpp
+ *
+ *    Non blocking transmission of KnxTpUart::txTask through the mock UART: order of
+ *    the control and data byte pairs, bytes left in the serial buffer, and the time
+ *    an ACK waits behind them, for several serial buffer sizes.
+ */
+
+#include "MockArduino.h"
+#include "KnxTest.h"
+#include "SimpleKnx.h"
+
+KNX_GROUP_ADDRESSES(G_ADDR(2,7,1));
+
+void telegramReceivedCallback(const KnxTelegram&) {}
+
+static const word groupAddresses[] = { G_ADDR(2,7,1) };
+static KnxTpUart *tpuart;
+static int sent;
+
+static void events(KnxTpUartEvent event) {
+    if (event == TPUART_EVENT_KNX_TELEGRAM_SENT) sent++;
+}
+
+static void runUntil(unsigned long timeMicrosec) {
+    while (mockNow() < timeMicrosec) {
+        mockAdvance(100);
+        tpuart->rxTask();
+        tpuart->txTask();
+    }
+}
+
+static void startTpUart(int serialBufferSize) {
+    mockReset();
+    mockSetTxBufferSize(serialBufferSize);
+    delete tpuart;
+    tpuart = new KnxTpUart(Serial, P_ADDR(1,1,12), groupAddresses, 1);
+    sent = 0;
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->reset());
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->setEvtCallback(events));
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->init());
+    runUntil(mockNow() + 5000);
+}
+
+static void makeTelegram(KnxTelegram& t, word groupAddress, byte length) {
+    byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE];
+
+    for (byte i = 0; i < length; i++) payload[i] = 0x40 + i;
+
+    t.setTargetAddress(groupAddress);
+    t.setCommand(KNX_COMMAND_VALUE_WRITE);
+    t.setPayload(payload, length);
+}
+
+// the frame goes out as ordered byte pairs, with at most KNX_TX_PENDING_MAX bytes waiting
+static void testOrderAndTiming(int serialBufferSize) {
+    KnxTelegram t;
+    int first;
+
+    startTpUart(serialBufferSize);
+    makeTelegram(t, G_ADDR(3,1,1), 10);
+    first = mockTxCount;
+
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->sendTelegram(t));
+    runUntil(mockNow() + 100000);
+
+    CHECK_EQUAL(1, sent);
+    CHECK_EQUAL(1, mockFrameCount);
+    CHECK_EQUAL(2 * t.getTelegramLength(), mockTxCount - first);
+    CHECK_EQUAL(t.getTelegramLength(), mockFrames[0].length);
+
+    for (byte i = 0; i < t.getTelegramLength(); i++) {
+        const MockTxByte *pair = &mockTxLog[first + 2 * i];
+        byte control = ((i + 1 == t.getTelegramLength()) ? TPUART_DATA_END_REQ : TPUART_DATA_START_CONTINUE_REQ) + i;
+
+        CHECK_EQUAL(control, pair[0].data);
+        CHECK_EQUAL(t.getRawByte(i), pair[1].data);
+        CHECK_EQUAL(t.getRawByte(i), mockFrames[0].data[i]);
+
+        // waiting behind at most KNX_TX_PENDING_MAX bytes, plus the one on the wire
+        CHECK(pair[0].sentTime - pair[0].writeTime <= (KNX_TX_PENDING_MAX + 1) * MOCK_SERIAL_BYTE_TIME);
+        CHECK(pair[1].sentTime - pair[1].writeTime <= (KNX_TX_PENDING_MAX + 1) * MOCK_SERIAL_BYTE_TIME);
+
+        // and the line keeps busy, the next pair is written within one loop
+        if (i > 0) CHECK(pair[0].sentTime - pair[-1].sentTime <= MOCK_SERIAL_BYTE_TIME + 100);
+    }
+
+    CHECK_EQUAL(0, mockTxBlockedTime());
+}
+
+// an ACK for a frame received while sending reaches the TPUART within the ACK window
+static void testAckWhileSending(int serialBufferSize) {
+    KnxTelegram t, rx;
+    byte raw[KNX_TELEGRAM_MAX_SIZE];
+    byte value = 1;
+    unsigned long start;
+
+    startTpUart(serialBufferSize);
+    makeTelegram(t, G_ADDR(3,1,1), 14);
+
+    rx.setSourceAddress(P_ADDR(1,1,5));
+    rx.setTargetAddress(G_ADDR(2,7,1));
+    rx.setCommand(KNX_COMMAND_VALUE_WRITE);
+    rx.setPayload(&value, 1);
+    rx.updateChecksum();
+    for (byte i = 0; i < rx.getTelegramLength(); i++) raw[i] = rx.getRawByte(i);
+
+    // the frame on the bus starts while the first pairs are streamed
+    CHECK_EQUAL(KNX_TPUART_OK, tpuart->sendTelegram(t));
+    runUntil(mockNow() + 300);
+    start = mockNow() + 200;
+    mockRxFrame(raw, rx.getTelegramLength(), start);
+    runUntil(start + 100000);
+
+    CHECK_EQUAL(1, mockAckCount);
+    CHECK_EQUAL(TPUART_RX_ACK_SERVICE_ADDRESSED, mockAcks[0].service);
+    CHECK(mockAcks[0].time - (start + (KNX_TELEGRAM_HEADER_SIZE - 1) * MOCK_BUS_CHARACTER_TIME) < 1700);
+    CHECK(tpuart->peekReceivedTelegram() != NULL);
+
+    // the telegram still went out complete
+    CHECK_EQUAL(1, sent);
+    CHECK_EQUAL(1, mockFrameCount);
+    CHECK_EQUAL(t.getTelegramLength(), mockFrames[0].length);
+    for (byte i = 0; i < t.getTelegramLength(); i++) CHECK_EQUAL(t.getRawByte(i), mockFrames[0].data[i]);
+    CHECK_EQUAL(0, mockTxBlockedTime());
+}
+
+int main(void) {
+    static const int sizes[] = { 16, 64, 128, 256 };
+
+    for (byte i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        testOrderAndTiming(sizes[i]);
+        testAckWhileSending(sizes[i]);
+    }
+
+    delete tpuart;
+
+    return knxTestResult("test_tx_uart");
+}
@@ -0,0 +1,132 @@
+/*
+ *    KnxChangeFilter.cpp
+ *
+ *    Written by Christian Poulter.
+ *
+ *    Copyright (C) 2023 Christian Poulter <devel(at)poulter.de>
+ *    All rights reserved. This file is now part of the Ardunio SimpleKnx Library.
+ *
+ *    The Ardunio SimpleKnx Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "KnxChangeFilter.h"
+#include "KnxTools.h"
+
+KnxChangeFilter::KnxChangeFilter() {
+    _count = 0;
+}
+
+// Filters the values for groupAddr, returns false if all KNX_CHANGE_FILTER_SIZE entries are taken.
+// A relative deadband is in percent of the last value sent.
+boolean KnxChangeFilter::setFilter(word groupAddr, float deadband, boolean relative, word minIntervalMillisec, word maxSilenceSec) {
+    KnxChangeEntry *entry = findEntry(groupAddr);
+
+    if (entry == NULL) {
+        if (_count == KNX_CHANGE_FILTER_SIZE) return false;
+
+        entry = &_entry[_count++];
+        entry->groupAddr = groupAddr;
+        entry->flags = 0;
+    }
+
+    entry->deadband = relative ? deadband / 100.0 : deadband;
+    entry->minIntervalMillisec = minIntervalMillisec;
+    entry->maxSilenceSec = maxSilenceSec;
+    entry->flags = (entry->flags & ~KNX_CHANGE_FLAG_RELATIVE) | (relative ? KNX_CHANGE_FLAG_RELATIVE : 0);
+
+    return true;
+}
+
+// Decides about value for groupAddr, group addresses without filter are always sent.
+// tag is kept with a value sent or held back, a suppressed value leaves it unchanged.
+KnxChangeDecision KnxChangeFilter::check(word groupAddr, float value, byte tag, unsigned long nowTime) {
+    KnxChangeEntry *entry = findEntry(groupAddr);
+    float limit;
+
+    if (entry == NULL) return KNX_CHANGE_SEND;
+    if (!(entry->flags & KNX_CHANGE_FLAG_SENT)) {
+        entry->tag = tag;
+        return KNX_CHANGE_SEND;
+    }
+
+    limit = (entry->flags & KNX_CHANGE_FLAG_RELATIVE) ? fabs(entry->sentValue) * entry->deadband : entry->deadband;
+
+    // also drops a value held back, the value went back to the one sent
+    if ((value == entry->sentValue) || (fabs(value - entry->sentValue) < limit)) {
+        entry->flags &= ~KNX_CHANGE_FLAG_PENDING;
+        return KNX_CHANGE_SUPPRESS;
+    }
+
+    if (TimeDeltaUnsignedLong(nowTime, entry->sentTimeMillisec) < entry->minIntervalMillisec) {
+        entry->pendingValue = value;
+        entry->tag = tag;
+        entry->flags |= KNX_CHANGE_FLAG_PENDING;
+        return KNX_CHANGE_DEFER;
+    }
+
+    entry->tag = tag;
+    return KNX_CHANGE_SEND;
+}
+
+// Returns true if the values for groupAddr are filtered
+boolean KnxChangeFilter::isFiltered(word groupAddr) {
+    return findEntry(groupAddr) != NULL;
+}
+
+// Records value as sent for groupAddr
+void KnxChangeFilter::sent(word groupAddr, float value, unsigned long nowTime) {
+    KnxChangeEntry *entry = findEntry(groupAddr);
+
+    if (entry == NULL) return;
+
+    entry->sentValue = value;
+    entry->sentTimeMillisec = nowTime;
+    entry->flags = (entry->flags | KNX_CHANGE_FLAG_SENT) & ~KNX_CHANGE_FLAG_PENDING;
+}
+
+// Returns a value held back whose minimum interval is over, or a value to be repeated after
+// the maximum silence. Call sent once it is queued.
+boolean KnxChangeFilter::pop(unsigned long nowTime, word& groupAddr, float& value, byte& tag) {
+    for (byte i = 0; i < _count; i++) {
+        KnxChangeEntry& entry = _entry[i];
+        unsigned long elapsed = TimeDeltaUnsignedLong(nowTime, entry.sentTimeMillisec);
+
+        if (!(entry.flags & KNX_CHANGE_FLAG_SENT)) continue;
+
+        if ((entry.flags & KNX_CHANGE_FLAG_PENDING) && (elapsed >= entry.minIntervalMillisec)) {
+            groupAddr = entry.groupAddr;
+            value = entry.pendingValue;
+            tag = entry.tag;
+            return true;
+        }
+
+        if ((entry.maxSilenceSec > 0) && (elapsed >= entry.maxSilenceSec * 1000UL)) {
+            groupAddr = entry.groupAddr;
+            value = entry.sentValue;
+            tag = entry.tag;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+KnxChangeEntry* KnxChangeFilter::findEntry(word groupAddr) {
+    for (byte i = 0; i < _count; i++) {
+        if (_entry[i].groupAddr == groupAddr) return &_entry[i];
+    }
+
+    return NULL;
+}
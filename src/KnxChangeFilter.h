@@ -0,0 +1,85 @@
+/*
+ *    KnxChangeFilter.h
+ *
+ *    Written by Christian Poulter.
+ *
+ *    Copyright (C) 2023 Christian Poulter <devel(at)poulter.de>
+ *    All rights reserved. This file is now part of the Ardunio SimpleKnx Library.
+ *
+ *    The Ardunio SimpleKnx Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef KNXCHANGEFILTER_H
+#define KNXCHANGEFILTER_H
+
+#include <Arduino.h>
+
+// Number of group addresses sent on change only
+#ifndef KNX_CHANGE_FILTER_SIZE
+#define KNX_CHANGE_FILTER_SIZE 4
+#endif
+
+// Flags of a filter entry
+#define KNX_CHANGE_FLAG_RELATIVE 0x01  // deadband is in percent of the last value sent
+#define KNX_CHANGE_FLAG_SENT     0x02  // a value has been sent
+#define KNX_CHANGE_FLAG_PENDING  0x04  // a value waits for the minimum interval
+
+// What to do with a new value
+enum KnxChangeDecision {
+    KNX_CHANGE_SEND = 0,        // send it, then call sent
+    KNX_CHANGE_SUPPRESS = 1,    // too close to the last value sent
+    KNX_CHANGE_DEFER = 2        // changed enough, but the last value was sent too recently
+};
+
+typedef struct KnxChangeEntry {
+    word groupAddr;
+    float deadband;                    // Smallest change sent, absolute or relative
+    word minIntervalMillisec;          // Shortest time between two values sent
+    word maxSilenceSec;                // Longest time without value sent, the last one is repeated then. 0 is never.
+    float sentValue;                   // Last value sent
+    float pendingValue;                // Newest value waiting for the minimum interval
+    unsigned long sentTimeMillisec;    // Time the last value was sent
+    byte tag;                          // Stored for the caller with the newest value sent or held back
+    byte flags;                        // KNX_CHANGE_FLAG_xxx
+} KnxChangeEntry;
+
+/*
+ * Send on change filter for numeric group values
+ *
+ * Remembers the last value sent per group address. A new value is suppressed while
+ * it stays within the deadband of that one. If it leaves the deadband within the
+ * minimum interval after the last value sent, it is held back and pop returns it
+ * once the interval is over, a newer value replaces it meanwhile. After the maximum
+ * silence, pop returns the last value sent to be repeated.
+ */
+class KnxChangeFilter {
+    KnxChangeEntry _entry[KNX_CHANGE_FILTER_SIZE];
+    byte _count;
+
+  public:
+    KnxChangeFilter();
+
+    boolean setFilter(word groupAddr, float deadband, boolean relative, word minIntervalMillisec, word maxSilenceSec);
+
+    KnxChangeDecision check(word groupAddr, float value, byte tag, unsigned long nowTime);
+    void sent(word groupAddr, float value, unsigned long nowTime);
+    boolean isFiltered(word groupAddr);
+    boolean pop(unsigned long nowTime, word& groupAddr, float& value, byte& tag);
+
+  private:
+    KnxChangeEntry* findEntry(word groupAddr);
+};
+
+#endif // KNXCHANGEFILTER_H
@@ -0,0 +1,74 @@
+/*
+ *    KnxDpt.cpp
+ *
+ *    Written by Christian Poulter.
+ *
+ *    Copyright (C) 2023 Christian Poulter <devel(at)poulter.de>
+ *    All rights reserved. This file is now part of the Ardunio SimpleKnx Library.
+ *
+ *    The Ardunio SimpleKnx Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <avr/pgmspace.h>
+#include "KnxDpt.h"
+
+// significant bits of 0 to 15
+static const byte nibbleBits[16] PROGMEM = { 0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+
+// The exponent is the number of significant bits of the value beyond the 11 bits of the mantissa,
+// taken from ~centi for negative values, as the mantissa still holds -2048. The last bit shifted
+// out rounds the mantissa up, as it did when the exponent was searched by shifting bit by bit.
+void KnxDptCodec<9>::encodeCenti(long centi, byte data[]) {
+    unsigned long magnitude = (centi < 0) ? ~centi : centi;
+    byte bits = 0;
+    byte top;
+
+    if (magnitude >> 16) {
+        bits = 16;
+        top = byte(magnitude >> 16);
+        if (magnitude >> 24) {
+            bits = 24;
+            top = byte(magnitude >> 24);
+        }
+    } else {
+        top = byte(magnitude);
+        if (magnitude >> 8) {
+            bits = 8;
+            top = byte(magnitude >> 8);
+        }
+    }
+
+    if (top >> 4) {
+        bits += 4;
+        top >>= 4;
+    }
+    bits += pgm_read_byte(&nibbleBits[top]);
+
+    byte exponent = (bits > 11) ? bits - 11 : 0;
+    long mantissa = centi >> exponent;
+    if (exponent && ((centi >> (exponent - 1)) & 1)) mantissa++;
+
+    data[1] = byte(mantissa);
+    data[0] = byte((byte(mantissa >> 8) & 0x07) + (exponent << 3) + ((centi < 0) ? 0x80 : 0));
+}
+
+long KnxDptCodec<9>::decodeCenti(const byte data[]) {
+    word mantissa = (word(data[0] & 0x07) << 8) | data[1];
+    boolean negative = data[0] & 0x80;
+    if (negative) mantissa = 2048 - mantissa; // absolute value of the 2's complement
+
+    long centi = (long)mantissa << ((data[0] & 0x78) >> 3);
+    return negative ? -centi : centi;
+}
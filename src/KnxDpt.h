@@ -0,0 +1,382 @@
+/*
+ *    KnxDpt.h
+ *
+ *    Written by Christian Poulter.
+ *
+ *    Copyright (C) 2023 Christian Poulter <devel(at)poulter.de>
+ *    All rights reserved. This file is now part of the Ardunio SimpleKnx Library.
+ *
+ *    The Ardunio SimpleKnx Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef KNXDPT_H
+#define KNXDPT_H
+
+#include <Arduino.h>
+
+/*
+ * Codecs for KNX datapoint types (visit "www.knx.org" for more info).
+ *
+ * Dpt<main, sub> names a datapoint type, e.g. Dpt<9, 1> for a temperature. Each one provides
+ *
+ *   typedef ... Type;                                   // value type
+ *   static constexpr byte size;                         // payload bytes behind the command field,
+ *                                                       // 0 for 6 bit values in the command field
+ *   static void encode(const Type& value, byte data[]); // size bytes, at least one
+ *   static Type decode(const byte data[]);
+ *
+ * Subtypes share the codec of their main type unless they scale the value, as 5.001 and 5.003.
+ * Everything is inlined, so only the codecs used are compiled in. See KnxTelegram::get and
+ * SimpleKnx_::groupWrite.
+ */
+template<word mainNumber>
+struct KnxDptCodec;
+
+template<word mainNumber, word subNumber>
+struct Dpt : KnxDptCodec<mainNumber> {};
+
+// values of the composed types
+typedef struct {
+    byte weekday;  // 1 = monday to 7 = sunday, 0 = no day
+    byte hour;
+    byte minute;
+    byte second;
+} KnxDptTime;
+
+typedef struct {
+    byte day;
+    byte month;
+    word year;     // 1990 to 2089
+} KnxDptDate;
+
+typedef struct {
+    word year;     // 1900 to 2155
+    byte month;
+    byte day;
+    byte weekday;  // 1 = monday to 7 = sunday, 0 = no day
+    byte hour;
+    byte minute;
+    byte second;
+    word flags;    // fault, working day, ... and clock quality bits as sent
+} KnxDptDateTime;
+
+typedef struct {
+    char text[15]; // up to 14 characters and a terminating 0
+} KnxDptString;
+
+typedef struct {
+    byte red;
+    byte green;
+    byte blue;
+} KnxDptRgb;
+
+typedef struct {
+    byte red;
+    byte green;
+    byte blue;
+    byte white;
+    byte valid;    // bit 3 red, 2 green, 1 blue, 0 white
+} KnxDptRgbw;
+
+// DPT 1 boolean
+template<>
+struct KnxDptCodec<1> {
+    typedef bool Type;
+    static constexpr byte size = 0;
+    static void encode(const Type& value, byte data[]) { data[0] = value ? 1 : 0; }
+    static Type decode(const byte data[]) { return data[0] & 0x01; }
+};
+
+// DPT 2 boolean with priority control, bit 1 control, bit 0 value
+template<>
+struct KnxDptCodec<2> {
+    typedef byte Type;
+    static constexpr byte size = 0;
+    static void encode(const Type& value, byte data[]) { data[0] = value & 0x03; }
+    static Type decode(const byte data[]) { return data[0] & 0x03; }
+};
+
+// DPT 3 controlled dimming or blinds, bit 3 direction, bits 2-0 step code (0 is stop)
+template<>
+struct KnxDptCodec<3> {
+    typedef byte Type;
+    static constexpr byte size = 0;
+    static void encode(const Type& value, byte data[]) { data[0] = value & 0x0F; }
+    static Type decode(const byte data[]) { return data[0] & 0x0F; }
+};
+
+// DPT 4 character
+template<>
+struct KnxDptCodec<4> {
+    typedef char Type;
+    static constexpr byte size = 1;
+    static void encode(const Type& value, byte data[]) { data[0] = value; }
+    static Type decode(const byte data[]) { return data[0]; }
+};
+
+// DPT 5 unsigned 8 bit value
+template<>
+struct KnxDptCodec<5> {
+    typedef byte Type;
+    static constexpr byte size = 1;
+    static void encode(const Type& value, byte data[]) { data[0] = value; }
+    static Type decode(const byte data[]) { return data[0]; }
+};
+
+// DPT 5.001 percent 0 to 100, rounded to 0 to 255
+template<>
+struct Dpt<5, 1> {
+    typedef byte Type;
+    static constexpr byte size = 1;
+    static void encode(const Type& value, byte data[]) { data[0] = (value >= 100) ? 255 : byte((word(value) * 255 + 50) / 100); }
+    static Type decode(const byte data[]) { return byte((word(data[0]) * 100 + 127) / 255); }
+};
+
+// DPT 5.003 angle 0 to 360 degrees, rounded to 0 to 255
+template<>
+struct Dpt<5, 3> {
+    typedef word Type;
+    static constexpr byte size = 1;
+    static void encode(const Type& value, byte data[]) { data[0] = (value >= 360) ? 255 : byte((long(value) * 255 + 180) / 360); }
+    static Type decode(const byte data[]) { return word((long(data[0]) * 360 + 127) / 255); }
+};
+
+// DPT 6 signed 8 bit value
+template<>
+struct KnxDptCodec<6> {
+    typedef int8_t Type;
+    static constexpr byte size = 1;
+    static void encode(const Type& value, byte data[]) { data[0] = byte(value); }
+    static Type decode(const byte data[]) { return int8_t(data[0]); }
+};
+
+// DPT 7 unsigned 16 bit value
+template<>
+struct KnxDptCodec<7> {
+    typedef word Type;
+    static constexpr byte size = 2;
+    static void encode(const Type& value, byte data[]) { data[0] = byte(value >> 8); data[1] = byte(value); }
+    static Type decode(const byte data[]) { return word((word(data[0]) << 8) | data[1]); }
+};
+
+// DPT 8 signed 16 bit value
+template<>
+struct KnxDptCodec<8> {
+    typedef int16_t Type;
+    static constexpr byte size = 2;
+    static void encode(const Type& value, byte data[]) { data[0] = byte(value >> 8); data[1] = byte(value); }
+    static Type decode(const byte data[]) { return int16_t(KnxDptCodec<7>::decode(data)); }
+};
+
+// DPT 9 2 byte float, "MEEE EMMM MMMM MMMM" with value = 0.01 * mantissa * 2^exponent.
+// encodeCenti and decodeCenti work on hundredths without any float arithmetic.
+template<>
+struct KnxDptCodec<9> {
+    typedef float Type;
+    static constexpr byte size = 2;
+
+    static void encode(const Type& value, byte data[]) { encodeCenti((long)(100.0 * value), data); }
+    static Type decode(const byte data[]) { return 0.01 * decodeCenti(data); }
+
+    static void encodeCenti(long centi, byte data[]);
+    static long decodeCenti(const byte data[]);
+};
+
+// DPT 10 time of day, "DDDH HHHH", "00MM MMMM", "00SS SSSS"
+template<>
+struct KnxDptCodec<10> {
+    typedef KnxDptTime Type;
+    static constexpr byte size = 3;
+
+    static void encode(const Type& value, byte data[]) {
+        data[0] = byte(value.weekday << 5) | (value.hour & 0x1F);
+        data[1] = value.minute & 0x3F;
+        data[2] = value.second & 0x3F;
+    }
+
+    static Type decode(const byte data[]) {
+        Type value = { byte(data[0] >> 5), byte(data[0] & 0x1F), byte(data[1] & 0x3F), byte(data[2] & 0x3F) };
+        return value;
+    }
+};
+
+// DPT 11 date, "000D DDDD", "0000 MMMM", "0YYY YYYY" with years from 90 in the 20th century
+template<>
+struct KnxDptCodec<11> {
+    typedef KnxDptDate Type;
+    static constexpr byte size = 3;
+
+    static void encode(const Type& value, byte data[]) {
+        data[0] = value.day & 0x1F;
+        data[1] = value.month & 0x0F;
+        data[2] = byte(value.year % 100);
+    }
+
+    static Type decode(const byte data[]) {
+        byte year = data[2] & 0x7F;
+        Type value = { byte(data[0] & 0x1F), byte(data[1] & 0x0F), word(year + ((year >= 90) ? 1900 : 2000)) };
+        return value;
+    }
+};
+
+// DPT 12 unsigned 32 bit value
+template<>
+struct KnxDptCodec<12> {
+    typedef uint32_t Type;
+    static constexpr byte size = 4;
+
+    static void encode(const Type& value, byte data[]) {
+        data[0] = byte(value >> 24);
+        data[1] = byte(value >> 16);
+        data[2] = byte(value >> 8);
+        data[3] = byte(value);
+    }
+
+    static Type decode(const byte data[]) {
+        return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (word(data[2]) << 8) | data[3];
+    }
+};
+
+// DPT 13 signed 32 bit value
+template<>
+struct KnxDptCodec<13> {
+    typedef int32_t Type;
+    static constexpr byte size = 4;
+    static void encode(const Type& value, byte data[]) { KnxDptCodec<12>::encode(uint32_t(value), data); }
+    static Type decode(const byte data[]) { return int32_t(KnxDptCodec<12>::decode(data)); }
+};
+
+// DPT 14 4 byte IEEE 754 float, most significant byte first
+template<>
+struct KnxDptCodec<14> {
+    typedef float Type;
+    static constexpr byte size = 4;
+
+    static void encode(const Type& value, byte data[]) {
+        uint32_t bits;
+        memcpy(&bits, &value, 4);
+        KnxDptCodec<12>::encode(bits, data);
+    }
+
+    static Type decode(const byte data[]) {
+        uint32_t bits = KnxDptCodec<12>::decode(data);
+        Type value;
+        memcpy(&value, &bits, 4);
+        return value;
+    }
+};
+
+// DPT 16 string of 14 characters, filled up with 0
+template<>
+struct KnxDptCodec<16> {
+    typedef KnxDptString Type;
+    static constexpr byte size = 14;
+
+    static void encode(const Type& value, byte data[]) {
+        byte i = 0;
+        for (; (i < size) && value.text[i]; i++) data[i] = value.text[i];
+        for (; i < size; i++) data[i] = 0;
+    }
+
+    static Type decode(const byte data[]) {
+        Type value;
+        memcpy(value.text, data, size);
+        value.text[size] = 0;
+        return value;
+    }
+};
+
+// DPT 17 scene number 0 to 63
+template<>
+struct KnxDptCodec<17> {
+    typedef byte Type;
+    static constexpr byte size = 1;
+    static void encode(const Type& value, byte data[]) { data[0] = value & 0x3F; }
+    static Type decode(const byte data[]) { return data[0] & 0x3F; }
+};
+
+// DPT 18 scene control, bit 7 learn, bits 5-0 scene number
+template<>
+struct KnxDptCodec<18> {
+    typedef byte Type;
+    static constexpr byte size = 1;
+    static void encode(const Type& value, byte data[]) { data[0] = value & 0xBF; }
+    static Type decode(const byte data[]) { return data[0] & 0xBF; }
+};
+
+// DPT 19 date and time, year since 1900, month, day, "DDDH HHHH", minute, second, 2 flag bytes
+template<>
+struct KnxDptCodec<19> {
+    typedef KnxDptDateTime Type;
+    static constexpr byte size = 8;
+
+    static void encode(const Type& value, byte data[]) {
+        data[0] = byte(value.year - 1900);
+        data[1] = value.month & 0x0F;
+        data[2] = value.day & 0x1F;
+        data[3] = byte(value.weekday << 5) | (value.hour & 0x1F);
+        data[4] = value.minute & 0x3F;
+        data[5] = value.second & 0x3F;
+        data[6] = byte(value.flags >> 8);
+        data[7] = byte(value.flags);
+    }
+
+    static Type decode(const byte data[]) {
+        Type value = { word(data[0] + 1900), byte(data[1] & 0x0F), byte(data[2] & 0x1F), byte(data[3] >> 5),
+                       byte(data[3] & 0x1F), byte(data[4] & 0x3F), byte(data[5] & 0x3F), word((word(data[6]) << 8) | data[7]) };
+        return value;
+    }
+};
+
+// DPT 232 RGB
+template<>
+struct KnxDptCodec<232> {
+    typedef KnxDptRgb Type;
+    static constexpr byte size = 3;
+
+    static void encode(const Type& value, byte data[]) {
+        data[0] = value.red;
+        data[1] = value.green;
+        data[2] = value.blue;
+    }
+
+    static Type decode(const byte data[]) {
+        Type value = { data[0], data[1], data[2] };
+        return value;
+    }
+};
+
+// DPT 251 RGBW, the fifth byte is reserved, the last one tells which colors are valid
+template<>
+struct KnxDptCodec<251> {
+    typedef KnxDptRgbw Type;
+    static constexpr byte size = 6;
+
+    static void encode(const Type& value, byte data[]) {
+        data[0] = value.red;
+        data[1] = value.green;
+        data[2] = value.blue;
+        data[3] = value.white;
+        data[4] = 0;
+        data[5] = value.valid & 0x0F;
+    }
+
+    static Type decode(const byte data[]) {
+        Type value = { data[0], data[1], data[2], data[3], byte(data[5] & 0x0F) };
+        return value;
+    }
+};
+
+#endif // KNXDPT_H
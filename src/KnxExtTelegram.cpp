@@ -0,0 +1,100 @@
+/*
+ *    KnxExtTelegram.cpp
+ *
+ *    Written by Christian Poulter.
+ *
+ *    Copyright (C) 2023 Christian Poulter <devel(at)poulter.de>
+ *    All rights reserved. This file is now part of the Ardunio SimpleKnx Library.
+ *
+ *    The Ardunio SimpleKnx Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "KnxExtTelegram.h"
+
+KnxExtTelegram::KnxExtTelegram() {
+    clearTelegram();
+}
+
+// clear telegram with default values :
+// extended FF, no repeat, normal prio, empty payload
+// multicast, routing counter = 6, payload length = 1
+void KnxExtTelegram::clearTelegram(void) {
+    memset(_telegram, 0, KNX_EXT_TELEGRAM_MAX_SIZE);
+
+    _controlField = EXT_CONTROL_FIELD_DEFAULT_VALUE;
+    _extControl = EXT_CONTROL_FIELD_EXT_DEFAULT_VALUE;
+    _length = 1;
+
+    // all other bytes are 0
+    _telegram[KNX_EXT_TELEGRAM_MIN_SIZE - 1] = byte(~(EXT_CONTROL_FIELD_DEFAULT_VALUE ^ EXT_CONTROL_FIELD_EXT_DEFAULT_VALUE ^ 1));
+}
+
+byte KnxExtTelegram::calculateChecksum(void) const {
+    byte xorSum = 0;
+    byte indexChecksum = getTelegramLength() - 1;
+
+    for (byte i = 0; i < indexChecksum; i++) {
+        xorSum ^= _telegram[i];
+    }
+
+    return byte(~xorSum);
+}
+
+void KnxExtTelegram::updateChecksum(void) {
+    _telegram[getTelegramLength() - 1] = calculateChecksum();
+}
+
+void KnxExtTelegram::copy(KnxExtTelegram& dest) const {
+    memcpy(dest._telegram, _telegram, getTelegramLength());
+}
+
+KnxTelegramValidity KnxExtTelegram::getValidity(void) const {
+    if ((_controlField & CONTROL_FIELD_PATTERN_MASK) != CONTROL_FIELD_VALID_PATTERN)
+        return KNX_TELEGRAM_INVALID_CONTROL_FIELD;
+
+    if (((_controlField & CONTROL_FIELD_FRAME_FORMAT_MASK) != CONTROL_FIELD_EXTENDED_FRAME_FORMAT) ||
+        (_extControl & EXT_CONTROL_FIELD_EXT_FRAME_FORMAT_MASK))
+        return KNX_TELEGRAM_UNSUPPORTED_FRAME_FORMAT;
+
+    if (!getPayloadLength() || (getTelegramLength() > KNX_EXT_TELEGRAM_MAX_SIZE))
+        return KNX_TELEGRAM_INCORRECT_PAYLOAD_LENGTH;
+
+    if ((_commandH & COMMAND_FIELD_PATTERN_MASK) != COMMAND_FIELD_VALID_PATTERN)
+        return KNX_TELEGRAM_INVALID_COMMAND_FIELD;
+
+    if (getChecksum() != calculateChecksum())
+        return KNX_TELEGRAM_INCORRECT_CHECKSUM;
+
+    byte cmd=getCommand();
+    if  (    (cmd!=KNX_COMMAND_VALUE_READ)  && (cmd!=KNX_COMMAND_VALUE_RESPONSE)
+          && (cmd!=KNX_COMMAND_VALUE_WRITE) && (cmd!=KNX_COMMAND_MEMORY_WRITE))
+        return KNX_TELEGRAM_UNKNOWN_COMMAND;
+
+    return KNX_TELEGRAM_VALID;
+}
+
+// same as KnxTelegram::setPayload, length 0 puts the 6 bit value into the command field
+void KnxExtTelegram::setPayload(const byte data[], byte length) {
+
+    if (length == 0) {
+        patchByte(_commandL, (_commandL & ~COMMAND_FIELD_LOW_DATA_MASK) | (data[0] & COMMAND_FIELD_LOW_DATA_MASK));
+
+    } else {
+        length = min(length, KNX_EXT_TELEGRAM_MAX_SIZE - KNX_EXT_TELEGRAM_LENGTH_OFFSET - 1);
+        setPayloadLength(length + 1);
+
+        for(byte i=0; i < length; i++) patchByte(_payloadChecksum[i], data[i]);
+    }
+}
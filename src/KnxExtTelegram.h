@@ -0,0 +1,257 @@
+/*
+ *    KnxExtTelegram.h
+ *
+ *    Written by Christian Poulter.
+ *
+ *    Copyright (C) 2023 Christian Poulter <devel(at)poulter.de>
+ *    All rights reserved. This file is now part of the Ardunio SimpleKnx Library.
+ *
+ *    The Ardunio SimpleKnx Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef KNXEXTTELEGRAM_H
+#define KNXEXTTELEGRAM_H
+
+#include <Arduino.h>
+#include "KnxTelegram.h"
+
+// ---------- Knx extended Telegram description (visit "www.knx.org" for more info) -----------
+// => Length : 10 bytes min. to KNX_EXT_TELEGRAM_MAX_SIZE bytes max.
+//
+// => Structure :
+//      -Header (7 bytes):
+//        Byte 0 | Control Field
+//        Byte 1 | Extended Control Field
+//        Byte 2 | Source Address High byte
+//        Byte 3 | Source Address Low byte
+//        Byte 4 | Destination Address High byte
+//        Byte 5 | Destination Address Low byte
+//        Byte 6 | Payload Length
+//      -Payload (from 2 up to 255 bytes):
+//        Byte 7 | Commmand field High
+//        Byte 8 | Command field Low + 1st payload data (6bits)
+//        Byte 9 and up | payload bytes (optional)
+//      -Checksum (1 byte)
+//
+// => Fields details :
+//      -Control Field : "00R1 PP00" format, like the standard frame but with frame format 00
+//      -Extended Control Field : "TCCC FFFF" format with
+//          T = Target Addr type (1 = group address/muticast, 0 = individual address/unicast)
+//        CCC = Counter
+//       FFFF = Extended Frame Format (0000 = L_DATA, others are not supported)
+//      -Payload Length : number of payload bytes behind the command field high byte
+//
+// Extended telegrams are rare and large, so they are kept apart from KnxTelegram:
+// standard telegrams, queues included, stay at KNX_TELEGRAM_MAX_SIZE bytes.
+// The TPUART sends at most 64 bytes per frame, longer telegrams can only be received.
+
+// Define for lengths & offsets
+#ifndef KNX_EXT_TELEGRAM_MAX_SIZE
+#define KNX_EXT_TELEGRAM_MAX_SIZE      64
+#endif
+#define KNX_EXT_TELEGRAM_HEADER_SIZE    7
+#define KNX_EXT_TELEGRAM_MIN_SIZE      10
+#define KNX_EXT_TELEGRAM_LENGTH_OFFSET  9 // Offset between payload length and telegram length
+
+static_assert((KNX_EXT_TELEGRAM_MAX_SIZE >= KNX_EXT_TELEGRAM_MIN_SIZE) && (KNX_EXT_TELEGRAM_MAX_SIZE <= 255),
+              "KNX_EXT_TELEGRAM_MAX_SIZE must be between 10 and 255");
+
+//--- CONTROL FIELD values & masks ---
+#define EXT_CONTROL_FIELD_DEFAULT_VALUE         0b00111100 // Extended FF; No Repeat; Normal Priority
+#define CONTROL_FIELD_EXTENDED_FRAME_FORMAT     0b00000000
+
+// --- EXTENDED CONTROL FIELD values & masks ---
+#define EXT_CONTROL_FIELD_EXT_DEFAULT_VALUE     0b11100000 // Multicast(Target Group @), Routing Counter = 6, L_DATA
+#define EXT_CONTROL_FIELD_EXT_FRAME_FORMAT_MASK 0b00001111
+
+class KnxExtTelegram {
+
+    union {
+        byte _telegram[KNX_EXT_TELEGRAM_MAX_SIZE];
+        struct {
+            byte _controlField; // byte 0
+            byte _extControl;   // byte 1
+            byte _sourceAddrH;  // byte 2
+            byte _sourceAddrL;  // byte 3
+            byte _targetAddrH;  // byte 4
+            byte _targetAddrL;  // byte 5
+            byte _length;       // byte 6
+            byte _commandH;     // byte 7
+            byte _commandL;     // byte 8
+            byte _payloadChecksum[KNX_EXT_TELEGRAM_MAX_SIZE - KNX_EXT_TELEGRAM_LENGTH_OFFSET]; // byte 9 and up
+        };
+    };
+
+  public:
+    KnxExtTelegram();
+    void copy(KnxExtTelegram& dest) const;
+
+    void setPriority(KnxPriority priority);
+    KnxPriority getPriority(void) const;
+
+    void setRepeated(void);
+    boolean isRepeated(void) const;
+
+    void setSourceAddress(word addr);
+    word getSourceAddress(void) const;
+
+    void setTargetAddress(word addr);
+    word getTargetAddress(void) const;
+
+    void setMulticast(boolean);
+    boolean isMulticast(void) const;
+
+    void setRoutingCounter(byte counter);
+    byte getRoutingCounter(void) const;
+
+    void setPayloadLength(byte length);
+    byte getPayloadLength(void) const;
+
+    byte getTelegramLength(void) const;
+
+    void setCommand(KnxCommand cmd);
+    KnxCommand getCommand(void) const;
+
+    byte getChecksum(void) const;
+    boolean isChecksumCorrect(void) const;
+
+    // raw data getter setter
+    // setRawByte does not maintain the checksum, call updateChecksum afterwards
+    void setPayload(const byte data[], byte length);
+    const byte* getPayload(void) const; // getPayloadLength() - 1 bytes
+    byte getRawByte(byte byteIndex) const;
+    void setRawByte(byte data, byte byteIndex);
+
+    // checksum
+    // all setters except setRawByte keep the checksum up to date
+    void clearTelegram(void); // (re)set telegram with default values
+    byte calculateChecksum(void) const;
+    void updateChecksum(void);
+    KnxTelegramValidity getValidity(void) const;
+
+  private:
+    void patchByte(byte& field, byte data);
+};
+
+// --------------- Definition of the INLINED functions : -----------------
+
+// see KnxTelegram::patchByte
+inline void KnxExtTelegram::patchByte(byte& field, byte data) {
+    _telegram[getTelegramLength() - 1] ^= field ^ data;
+    field = data;
+}
+
+inline void KnxExtTelegram::setPriority(KnxPriority priority) {
+    patchByte(_controlField, (_controlField & ~CONTROL_FIELD_PRIORITY_MASK) | (priority & CONTROL_FIELD_PRIORITY_MASK));
+}
+
+inline KnxPriority KnxExtTelegram::getPriority(void) const {
+    return (KnxPriority)(_controlField & CONTROL_FIELD_PRIORITY_MASK);
+}
+
+inline void KnxExtTelegram::setRepeated(void) {
+    byte controlField = _controlField;
+    CONTROL_FIELD_SET_REPEATED(controlField);
+    patchByte(_controlField, controlField);
+}
+
+inline boolean KnxExtTelegram::isRepeated(void) const {
+    return !(_controlField & CONTROL_FIELD_REPEATED_MASK);
+}
+
+inline void KnxExtTelegram::setSourceAddress(word addr) {
+    patchByte(_sourceAddrL, (byte) addr);
+    patchByte(_sourceAddrH, byte(addr>>8));
+}
+
+inline word KnxExtTelegram::getSourceAddress(void) const {
+    return _sourceAddrL + (word(_sourceAddrH)<<8);
+}
+
+inline void KnxExtTelegram::setTargetAddress(word addr) {
+    patchByte(_targetAddrL, (byte) addr);
+    patchByte(_targetAddrH, byte(addr>>8));
+}
+
+inline word KnxExtTelegram::getTargetAddress(void) const {
+    return _targetAddrL + (word(_targetAddrH)<<8);
+}
+
+inline boolean KnxExtTelegram::isMulticast(void) const {
+    return (_extControl & ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK);
+}
+
+inline void KnxExtTelegram::setMulticast(boolean mode) {
+    if (mode) {
+        patchByte(_extControl, _extControl | ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK);
+    } else {
+        patchByte(_extControl, _extControl & ~ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK);
+    }
+}
+
+inline void KnxExtTelegram::setRoutingCounter(byte counter) {
+    counter <<= 4;
+    patchByte(_extControl, (_extControl & ~ROUTING_FIELD_COUNTER_MASK) | (counter & ROUTING_FIELD_COUNTER_MASK));
+}
+
+inline byte KnxExtTelegram::getRoutingCounter(void) const {
+    return ((_extControl & ROUTING_FIELD_COUNTER_MASK)>>4);
+}
+
+// moves the checksum, so it is the only setter doing a full recalculation
+inline void KnxExtTelegram::setPayloadLength(byte length) {
+    _length = min(length, KNX_EXT_TELEGRAM_MAX_SIZE - KNX_EXT_TELEGRAM_LENGTH_OFFSET);
+    updateChecksum();
+}
+
+inline byte KnxExtTelegram::getPayloadLength(void) const {
+    return _length;
+}
+
+inline byte KnxExtTelegram::getTelegramLength(void) const {
+    return (KNX_EXT_TELEGRAM_LENGTH_OFFSET + getPayloadLength());
+}
+
+inline void KnxExtTelegram::setCommand(KnxCommand cmd) {
+    patchByte(_commandH, (_commandH & ~COMMAND_FIELD_HIGH_COMMAND_MASK) | (cmd >> 2));
+    patchByte(_commandL, (_commandL & ~COMMAND_FIELD_LOW_COMMAND_MASK) | byte(cmd << 6));
+}
+
+inline KnxCommand KnxExtTelegram::getCommand(void) const {
+    return (KnxCommand)(((_commandL & COMMAND_FIELD_LOW_COMMAND_MASK)>>6) +
+                        ((_commandH & COMMAND_FIELD_HIGH_COMMAND_MASK)<<2));
+}
+
+inline const byte* KnxExtTelegram::getPayload(void) const {
+    return _payloadChecksum;
+}
+
+inline byte KnxExtTelegram::getRawByte(byte byteIndex) const {
+    return _telegram[byteIndex];
+}
+
+inline void KnxExtTelegram::setRawByte(byte data, byte byteIndex) {
+    _telegram[byteIndex] = data;
+}
+
+inline byte KnxExtTelegram::getChecksum(void) const {
+    return _telegram[getTelegramLength() - 1];
+}
+
+inline boolean KnxExtTelegram::isChecksumCorrect(void) const {
+    return (getChecksum()==calculateChecksum());
+}
+
+#endif // KNXEXTTELEGRAM_H
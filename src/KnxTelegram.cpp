@@ -42,6 +42,7 @@
  */
 
 #include "KnxTelegram.h"
+#include "KnxDpt.h"
 #include "DebugUtil.h"
 
 KnxTelegram::KnxTelegram() {
@@ -56,6 +57,9 @@ void KnxTelegram::clearTelegram(void) {
   
     _controlField = CONTROL_FIELD_DEFAULT_VALUE; 
     _routing= ROUTING_FIELD_DEFAULT_VALUE;
+
+    // all other bytes are 0, payload length is 1
+    _telegram[KNX_TELEGRAM_MIN_SIZE - 1] = byte(~(CONTROL_FIELD_DEFAULT_VALUE ^ ROUTING_FIELD_DEFAULT_VALUE));
 }
 
 byte KnxTelegram::calculateChecksum(void) const {
@@ -82,6 +86,7 @@ void KnxTelegram::copy(KnxTelegram& dest) const {
 
 void KnxTelegram::copyHeader(KnxTelegram& dest) const {
     memcpy(dest._telegram, _telegram, KNX_TELEGRAM_HEADER_SIZE);
+    dest.updateChecksum();
 }
 
 KnxTelegramValidity KnxTelegram::getValidity(void) const {
@@ -111,63 +116,58 @@ KnxTelegramValidity KnxTelegram::getValidity(void) const {
 void KnxTelegram::setPayload(const byte data[], byte length) {
     
     if (length == 0) {
-        _commandL &= ~COMMAND_FIELD_LOW_DATA_MASK;
-        _commandL |= data[0] & COMMAND_FIELD_LOW_DATA_MASK;
+        patchByte(_commandL, (_commandL & ~COMMAND_FIELD_LOW_DATA_MASK) | (data[0] & COMMAND_FIELD_LOW_DATA_MASK));
         
     } else {
         setPayloadLength(length + 1);
         
         length = min(length, KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2);
-        for(byte i=0; i < length; i++) _payloadChecksum[i] = data[i];
+        for(byte i=0; i < length; i++) patchByte(_payloadChecksum[i], data[i]);
     }
 }
 
 // --------------- DPT functions ---------------
-bool KnxTelegram::getBool() {
+bool KnxTelegram::getBool() const {
     if (getPayloadLength() != 1) { return 0; }
 
     return _commandL & B00000001;
 }
 
-byte KnxTelegram::get2BitIntValue() {
+byte KnxTelegram::get2BitIntValue() const {
     if (getPayloadLength() != 1) { return 0; }
 
     return _commandL & B00000011;
 }
 
-byte KnxTelegram::get4BitIntValue() {
+byte KnxTelegram::get4BitIntValue() const {
     if (getPayloadLength() != 1) { return 0; }
 
     return _commandL & B00001111;
 }
 
-byte KnxTelegram::get1ByteIntValue() {
+byte KnxTelegram::get1ByteIntValue() const {
     if (getPayloadLength() != 2) { return 0; }
 
     return _payloadChecksum[0];
 }
 
-int KnxTelegram::get2ByteIntValue() {
+int KnxTelegram::get2ByteIntValue() const {
     if (getPayloadLength() != 3) { return 0; }
   
-    return int(_payloadChecksum[0] << 8) + int(_payloadChecksum[1]);
+    return int((word(_payloadChecksum[0]) << 8) + _payloadChecksum[1]);
+}
+
+float KnxTelegram::get2ByteFloatValue() const {
+    return get<Dpt<9, 1> >();
 }
 
-float KnxTelegram::get2ByteFloatValue() {
+long KnxTelegram::get2ByteFixedValue() const {
     if (getPayloadLength() != 3) { return 0; }
 
-    int signMultiplier = (_payloadChecksum[0] & 0x80) ? -1 : 1;
-    word absoluteMantissa = _payloadChecksum[1] + ((_payloadChecksum[0] & 0x07) << 8);
-    if (signMultiplier == -1) {  // Calculate absolute mantissa value in case of negative mantissa
-        // Abs = 2's complement + 1
-        absoluteMantissa = ((~absoluteMantissa) & 0x07FF) + 1;
-    }
-    byte exponent = (_payloadChecksum[0] & 0x78) >> 3;
-    
-    return (0.01 * ((long)absoluteMantissa << exponent) * signMultiplier);
+    return KnxDptCodec<9>::decodeCenti(_payloadChecksum);
 }
 
-float KnxTelegram::get4ByteFloatValue() {
+float KnxTelegram::get4ByteFloatValue() const {
     if (getPayloadLength() != 5) {
         return 0;
     }
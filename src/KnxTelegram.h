@@ -188,31 +188,48 @@ class KnxTelegram {
     boolean isChecksumCorrect(void) const;
 
     // raw data getter setter
+    // setRawByte does not maintain the checksum, call updateChecksum afterwards
     void setPayload(const byte data[], byte length);
     byte getRawByte(byte byteIndex) const;
     void setRawByte(byte data, byte byteIndex);
 
     // checksum
+    // all setters except setRawByte keep the checksum up to date
     void clearTelegram(void); // (re)set telegram with default values
     byte calculateChecksum(void) const;
     void updateChecksum(void);
     KnxTelegramValidity getValidity(void) const;
 
     // get DPT
-    bool getBool();
-    byte get2BitIntValue();
-    byte get4BitIntValue();
-    byte get1ByteIntValue();
-    int get2ByteIntValue();
-    float get2ByteFloatValue();
-    float get4ByteFloatValue();
-    
+    bool getBool() const;
+    byte get2BitIntValue() const;
+    byte get4BitIntValue() const;
+    byte get1ByteIntValue() const;
+    int get2ByteIntValue() const;
+    float get2ByteFloatValue() const;
+    long get2ByteFixedValue() const; // 2 byte float in hundredths, without float arithmetic
+    float get4ByteFloatValue() const;
+
+    // value of any datapoint type of KnxDpt.h, e.g. get<Dpt<9, 1>>(). Like the
+    // getters above, 0 or an empty value if the payload length does not fit.
+    template<typename D>
+    typename D::Type get(void) const;
+
+  private:
+    void patchByte(byte& field, byte data);
 };
 
 // --------------- Definition of the INLINED functions : -----------------
+
+// Sets a byte in front of the checksum and patches the checksum with the
+// changed bits, so the checksum never needs a full recalculation
+inline void KnxTelegram::patchByte(byte& field, byte data) {
+    _telegram[getTelegramLength() - 1] ^= field ^ data;
+    field = data;
+}
+
 inline void KnxTelegram::setPriority(KnxPriority priority) { 
-    _controlField &= ~CONTROL_FIELD_PRIORITY_MASK;
-    _controlField |= priority & CONTROL_FIELD_PRIORITY_MASK;
+    patchByte(_controlField, (_controlField & ~CONTROL_FIELD_PRIORITY_MASK) | (priority & CONTROL_FIELD_PRIORITY_MASK));
 }
     
 inline KnxPriority KnxTelegram::getPriority(void) const {
@@ -220,7 +237,9 @@ inline KnxPriority KnxTelegram::getPriority(void) const {
 }
 
 inline void KnxTelegram::setRepeated(void ) {
-    CONTROL_FIELD_SET_REPEATED(_controlField);
+    byte controlField = _controlField;
+    CONTROL_FIELD_SET_REPEATED(controlField);
+    patchByte(_controlField, controlField);
 };
     
 inline boolean KnxTelegram::isRepeated(void) const {
@@ -230,27 +249,27 @@ inline boolean KnxTelegram::isRepeated(void) const {
 // WARNING : works with little endianness only
 // The adresses within KNX telegram are big endian
 inline void KnxTelegram::setSourceAddress(word addr) { 
-    _sourceAddrL = (byte) addr;
-    _sourceAddrH = byte(addr>>8);
+    patchByte(_sourceAddrL, (byte) addr);
+    patchByte(_sourceAddrH, byte(addr>>8));
 }
 
 // WARNING : works with little endianness only
 // The adresses within KNX telegram are big endian
 inline word KnxTelegram::getSourceAddress(void) const {
-    return _sourceAddrL + (_sourceAddrH<<8);
+    return _sourceAddrL + (word(_sourceAddrH)<<8);
 }
 
 // WARNING : works with little endianness only
 // The adresses within KNX telegram are big endian
 inline void KnxTelegram::setTargetAddress(word addr) { 
-    _targetAddrL = (byte) addr;
-    _targetAddrH = byte(addr>>8);
+    patchByte(_targetAddrL, (byte) addr);
+    patchByte(_targetAddrH, byte(addr>>8));
 }
 
 // WARNING : endianess sensitive!! Code below is for LITTLE ENDIAN chip
 // The KNX telegram uses BIG ENDIANNESS (Hight byte placed before Low Byte)
 inline word KnxTelegram::getTargetAddress(void) const {
-    return _targetAddrL + (_targetAddrH<<8);
+    return _targetAddrL + (word(_targetAddrH)<<8);
 }
 
 inline boolean KnxTelegram::isMulticast(void) const {
@@ -259,25 +278,26 @@ inline boolean KnxTelegram::isMulticast(void) const {
 
 inline void KnxTelegram::setMulticast(boolean mode) {
     if (mode) {
-        _routing |= ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK;
+        patchByte(_routing, _routing | ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK);
     } else {
-        _routing &= ~ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK;
+        patchByte(_routing, _routing & ~ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK);
     }
 }
  
 inline void KnxTelegram::setRoutingCounter(byte counter) {
     counter <<= 4;
-    _routing &= ~ROUTING_FIELD_COUNTER_MASK;
-    _routing |= (counter & ROUTING_FIELD_COUNTER_MASK);
+    patchByte(_routing, (_routing & ~ROUTING_FIELD_COUNTER_MASK) | (counter & ROUTING_FIELD_COUNTER_MASK));
 }
 
 inline byte KnxTelegram::getRoutingCounter(void) const {
     return ((_routing & ROUTING_FIELD_COUNTER_MASK)>>4);
 }
 
+// moves the checksum, so it is the only setter doing a full recalculation
 inline void KnxTelegram::setPayloadLength(byte length) {
     _routing &= ~ROUTING_FIELD_PAYLOAD_LENGTH_MASK;
     _routing |= length & ROUTING_FIELD_PAYLOAD_LENGTH_MASK;
+    updateChecksum();
 }
 
 inline byte KnxTelegram::getPayloadLength(void) const {
@@ -289,11 +309,8 @@ inline byte KnxTelegram::getTelegramLength(void) const {
 }
 
 inline void KnxTelegram::setCommand(KnxCommand cmd) {
-    _commandH &= ~COMMAND_FIELD_HIGH_COMMAND_MASK;
-    _commandH |= (cmd >> 2);
-    
-    _commandL &= ~COMMAND_FIELD_LOW_COMMAND_MASK;
-    _commandL |= (cmd << 6);
+    patchByte(_commandH, (_commandH & ~COMMAND_FIELD_HIGH_COMMAND_MASK) | (cmd >> 2));
+    patchByte(_commandL, (_commandL & ~COMMAND_FIELD_LOW_COMMAND_MASK) | byte(cmd << 6));
 }
 
 inline KnxCommand KnxTelegram::getCommand(void) const {
@@ -317,4 +334,11 @@ inline boolean KnxTelegram::isChecksumCorrect(void) const {
     return (getChecksum()==calculateChecksum());
 }
 
+template<typename D>
+inline typename D::Type KnxTelegram::get(void) const {
+    if (getPayloadLength() != D::size + 1) return typename D::Type();
+
+    return D::decode(D::size ? _payloadChecksum : &_commandL);
+}
+
 #endif // KNXTELEGRAM_H
@@ -0,0 +1,171 @@
+/*
+ *    KnxTimerWheel.cpp
+ *
+ *    Written by Christian Poulter.
+ *
+ *    Copyright (C) 2023 Christian Poulter <devel(at)poulter.de>
+ *    All rights reserved. This file is now part of the Ardunio SimpleKnx Library.
+ *
+ *    The Ardunio SimpleKnx Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "KnxTimerWheel.h"
+#include "KnxTools.h"
+
+KnxTimerWheel::KnxTimerWheel() {
+    for (byte i = 0; i < KNX_CYCLIC_SIZE; i++) {
+        _timer[i].period = 0;
+        _timer[i].next = i + 1;
+    }
+    _timer[KNX_CYCLIC_SIZE - 1].next = KNX_TIMER_NONE;
+    memset(_slot, KNX_TIMER_NONE, sizeof(_slot));
+
+    _free = 0;
+    _now = 0;
+    _lastTickMillisec = millis();
+    _random = 1;
+}
+
+// Seeds the random first expiry, use something differing between devices
+void KnxTimerWheel::setSeed(word seed) {
+    _random = (seed != 0) ? seed : 1;
+}
+
+// Expires groupAddr every periodMillisec, 0 removes the timer. Returns false if all
+// KNX_CYCLIC_SIZE timers are taken.
+boolean KnxTimerWheel::setTimer(word groupAddr, unsigned long periodMillisec) {
+    unsigned long ticks = min((periodMillisec + KNX_CYCLIC_TICK / 2) / KNX_CYCLIC_TICK, 65535UL);
+    byte index;
+
+    for (index = 0; index < KNX_CYCLIC_SIZE; index++) {
+        if ((_timer[index].period != 0) && (_timer[index].groupAddr == groupAddr)) break;
+    }
+
+    if (index < KNX_CYCLIC_SIZE) {
+        unlink(index);
+
+    } else {
+        if ((periodMillisec == 0) || (_free == KNX_TIMER_NONE)) return (periodMillisec == 0);
+
+        index = _free;
+        _free = _timer[index].next;
+    }
+
+    if (periodMillisec == 0) {
+        _timer[index].period = 0;
+        _timer[index].next = _free;
+        _free = index;
+        return true;
+    }
+
+    _timer[index].groupAddr = groupAddr;
+    _timer[index].period = max(ticks, 1UL);
+    _timer[index].expires = _now + 1 + nextRandom() % _timer[index].period;
+    insert(index);
+
+    return true;
+}
+
+// Runs the ticks elapsed until nowTime, callback is called for every expired timer
+void KnxTimerWheel::advance(unsigned long nowTime, TimerCallbackFctPtr callback) {
+    while (TimeDeltaUnsignedLong(nowTime, _lastTickMillisec) >= KNX_CYCLIC_TICK) {
+        _lastTickMillisec += KNX_CYCLIC_TICK;
+        tick(callback);
+    }
+}
+
+void KnxTimerWheel::tick(TimerCallbackFctPtr callback) {
+    word due[KNX_CYCLIC_SIZE];
+    byte dueCount = 0;
+    byte index;
+
+    _now++;
+
+    // level 0 went round, spread the next level 1 slot over it
+    if ((_now & KNX_TIMER_WHEEL_MASK) == 0) {
+        index = _slot[1][(_now >> KNX_TIMER_WHEEL_BITS) & KNX_TIMER_WHEEL_MASK];
+        _slot[1][(_now >> KNX_TIMER_WHEEL_BITS) & KNX_TIMER_WHEEL_MASK] = KNX_TIMER_NONE;
+
+        while (index != KNX_TIMER_NONE) {
+            byte next = _timer[index].next;
+            insert(index);
+            index = next;
+        }
+    }
+
+    // everything in the level 0 slot is due now
+    index = _slot[0][_now & KNX_TIMER_WHEEL_MASK];
+    _slot[0][_now & KNX_TIMER_WHEEL_MASK] = KNX_TIMER_NONE;
+
+    while (index != KNX_TIMER_NONE) {
+        byte next = _timer[index].next;
+
+        _timer[index].expires += _timer[index].period;
+        insert(index);
+        due[dueCount++] = _timer[index].groupAddr;
+
+        index = next;
+    }
+
+    // all timers are in place again, so the callback may change them
+    if (callback != NULL) {
+        for (byte i = 0; i < dueCount; i++) callback(due[i]);
+    }
+}
+
+// puts the timer into the slot of its expiry, it must be at least one tick ahead
+void KnxTimerWheel::insert(byte index) {
+    word delta = _timer[index].expires - _now;
+    byte *slot;
+
+    if (delta < KNX_TIMER_WHEEL_SLOTS) {
+        slot = &_slot[0][_timer[index].expires & KNX_TIMER_WHEEL_MASK];
+
+    } else if (delta < KNX_TIMER_WHEEL_SLOTS * KNX_TIMER_WHEEL_SLOTS) {
+        slot = &_slot[1][(_timer[index].expires >> KNX_TIMER_WHEEL_BITS) & KNX_TIMER_WHEEL_MASK];
+
+    } else {
+        // the last level 1 slot, placed again when it comes up
+        slot = &_slot[1][((_now >> KNX_TIMER_WHEEL_BITS) - 1) & KNX_TIMER_WHEEL_MASK];
+    }
+
+    _timer[index].next = *slot;
+    *slot = index;
+}
+
+// removes the timer from its slot, the list of each slot is searched
+boolean KnxTimerWheel::unlink(byte index) {
+    for (byte level = 0; level < 2; level++) {
+        for (byte i = 0; i < KNX_TIMER_WHEEL_SLOTS; i++) {
+            for (byte *link = &_slot[level][i]; *link != KNX_TIMER_NONE; link = &_timer[*link].next) {
+                if (*link == index) {
+                    *link = _timer[index].next;
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+// xorshift, good enough to spread the first expiries
+word KnxTimerWheel::nextRandom(void) {
+    _random ^= _random << 7;
+    _random ^= _random >> 9;
+    _random ^= _random << 8;
+
+    return _random;
+}
@@ -0,0 +1,90 @@
+/*
+ *    KnxTimerWheel.h
+ *
+ *    Written by Christian Poulter.
+ *
+ *    Copyright (C) 2023 Christian Poulter <devel(at)poulter.de>
+ *    All rights reserved. This file is now part of the Ardunio SimpleKnx Library.
+ *
+ *    The Ardunio SimpleKnx Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef KNXTIMERWHEEL_H
+#define KNXTIMERWHEEL_H
+
+#include <Arduino.h>
+
+// Number of group addresses sent cyclically
+#ifndef KNX_CYCLIC_SIZE
+#define KNX_CYCLIC_SIZE 8
+#endif
+
+// Resolution of the cyclic periods, the longest period is 65535 ticks
+#ifndef KNX_CYCLIC_TICK
+#define KNX_CYCLIC_TICK 100 // ms
+#endif
+
+#define KNX_TIMER_WHEEL_BITS  4
+#define KNX_TIMER_WHEEL_SLOTS (1 << KNX_TIMER_WHEEL_BITS) // slots per level
+#define KNX_TIMER_WHEEL_MASK  (KNX_TIMER_WHEEL_SLOTS - 1)
+#define KNX_TIMER_NONE        255
+
+static_assert(KNX_CYCLIC_SIZE < KNX_TIMER_NONE, "KNX_CYCLIC_SIZE must be below 255");
+
+typedef struct KnxTimer {
+    word groupAddr;
+    word period;                       // Ticks between two expiries, 0 if the timer is unused
+    word expires;                      // Tick of the next expiry
+    byte next;                         // Next timer in the same slot or in the free list
+} KnxTimer;
+
+// Typedef for the expiry callback function
+typedef void (*TimerCallbackFctPtr) (word groupAddr);
+
+/*
+ * Two level timer wheel for the cyclic group addresses
+ *
+ * Level 0 has a slot per tick for the next KNX_TIMER_WHEEL_SLOTS ticks, level 1 a
+ * slot per KNX_TIMER_WHEEL_SLOTS ticks. Once level 0 went round, the next level 1
+ * slot is spread over level 0. Timers further away wait in the last level 1 slot
+ * and are placed again when it comes up. So a tick only touches the timers due
+ * or moving down, no matter how many timers there are.
+ *
+ * A new timer expires first after a random part of its period, so devices powered
+ * up together do not all send at once.
+ */
+class KnxTimerWheel {
+    KnxTimer _timer[KNX_CYCLIC_SIZE];
+    byte _slot[2][KNX_TIMER_WHEEL_SLOTS]; // first timer per slot and level
+    byte _free;                        // first unused timer
+    word _now;                         // current tick
+    unsigned long _lastTickMillisec;
+    word _random;                      // xorshift state, never 0
+
+  public:
+    KnxTimerWheel();
+
+    void setSeed(word seed);
+    boolean setTimer(word groupAddr, unsigned long periodMillisec);
+    void advance(unsigned long nowTime, TimerCallbackFctPtr callback);
+
+  private:
+    void tick(TimerCallbackFctPtr callback);
+    void insert(byte index);
+    boolean unlink(byte index);
+    word nextRandom(void);
+};
+
+#endif // KNXTIMERWHEEL_H
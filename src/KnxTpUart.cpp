@@ -47,7 +47,7 @@
 #include "KnxTools.h"
 
 // Constructor
-KnxTpUart::KnxTpUart(HardwareSerial& serial, word physicalAddr, word groupAddressList[], byte groupAddressListSize):
+KnxTpUart::KnxTpUart(HardwareSerial& serial, word physicalAddr, const word groupAddressList[], word groupAddressListSize):
     _serial(serial),
     _physicalAddr(physicalAddr),
     _groupAddressList(groupAddressList),
@@ -57,13 +57,34 @@ KnxTpUart::KnxTpUart(HardwareSerial& serial, word physicalAddr, word groupAddres
       
     _rx.state = RX_RESET;
     _rx.readBytes = 0;
+    _rx.expectedLength = 0;
+    _rx.lastByteTimeMicrosec = 0;
+    _rx.eopGapMicrosec = KNX_RX_EOP_GAP;
+    _rx.queueMaxCount = 0;
+    _rx.queueOverflowCount = 0;
+    _rx.recentIndex = 0;
+    _rx.duplicateCount = 0;
+    memset(_rx.recent, 0, sizeof(_rx.recent));
+    _rx.receivedTelegram = _rx.queue.reserve();
+    _rx.extended = false;
+    _rx.extTelegram = NULL;
+    _rx.extTelegramReceived = false;
     
     _tx.state = TX_RESET;
     _tx.sentTelegram = NULL;
+    _tx.sentExtTelegram = NULL;
     _tx.bytesRemaining = 0;
     _tx.txByteIndex = 0;
+    _tx.retries = 0;
+    _tx.maxRetries = 0;
+    _tx.retryTimeMillisec = 0;
+    _tx.startTimeMicrosec = 0;
+    _tx.nextTelegram = NULL;
+    _tx.nextMaxRetries = 0;
+    _tx.serialFreeMax = 0;
     
     _evtCallbackFct = NULL;
+    _busmon = NULL;
 }
 
 // Destructor
@@ -71,6 +92,9 @@ KnxTpUart::~KnxTpUart() {
     if ((_rx.state > RX_RESET) || (_tx.state > TX_RESET)) {
         _serial.end();
     }    
+
+    delete _busmon;
+    delete _rx.extTelegram;
 }
 
 // Reset the Arduino UART port and the TPUART device
@@ -88,10 +112,25 @@ byte KnxTpUart::reset(void) {
         _rx.state = RX_RESET;
         _tx.state = TX_RESET;
     }
+
+    // a prepared telegram is not sent after the reset
+    _tx.nextTelegram = NULL;
+
+    // the TPUART leaves bus monitor mode on reset only
+    delete _busmon;
+    _busmon = NULL;
     
     // CONFIGURATION OF THE ARDUINO UART WITH CORRECT FRAME FORMAT (19200, 8 bits, parity even, 1 stop bit)
     _serial.begin(19200, SERIAL_8E1);
 
+    // the buffer is empty now, whatever size the core gave it
+    _tx.serialFreeMax = _serial.availableForWrite();
+
+#ifdef KNX_RX_ISR
+    // rxIsr stays away from the serial as long as we are not in idle state
+    _rxRing.clear();
+#endif
+
     while (attempts--) {  // we send a RESET REQUEST and wait for the reset indication answer
 
         DEBUG0_PRINTLN(F("Reset attempts: %d"), attempts);
@@ -153,176 +192,378 @@ byte KnxTpUart::setEvtCallback(EventCallbackFctPtr evtCallbackFct) {
 /*
  * Reception task
  * 
+ * Processes all bytes received so far in one pass and returns their number.
+ *
  * DO NOT PUT TOO MUCH DEBUG PRINT CODE HERE! Telegram receiving might break!
  */
-void KnxTpUart::rxTask(void) {  
+byte KnxTpUart::rxTask(void) {  
     byte incomingByte;
+    byte availableBytes;
+    byte processedBytes = 0;
     unsigned long nowTime;
-    
-    static byte expectedTelegramLength = 0;
-    static KnxTelegram telegram;
-    static unsigned long lastByteRxTimeMicrosec;
 
+    // one timestamp for the whole burst
     nowTime = micros();
-    DEBUG5_PRINTLN(F("RxTask: %lu %lu %lu %d"), nowTime, lastByteRxTimeMicrosec, TimeDeltaUnsignedLong(nowTime, lastByteRxTimeMicrosec), _rx.state);
+    DEBUG5_PRINTLN(F("RxTask: %lu %lu %lu %d"), nowTime, _rx.lastByteTimeMicrosec, TimeDeltaUnsignedLong(nowTime, _rx.lastByteTimeMicrosec), _rx.state);
+
+    availableBytes = rxAvailable();
     
     // === STEP 1 : Check EOP in case a Telegram is being received ===
-    if (_rx.state >= RX_KNX_TELEGRAM_RECEPTION_STARTED) {
-        if (TimeDeltaUnsignedLong(nowTime, lastByteRxTimeMicrosec) > KNX_RX_TIMEOUT ) {
-            DEBUG5_PRINTLN(F("EOP REACHED"));
-            rxTaskFinished(telegram);
+    // pending bytes are not EOP, they just have not been processed yet
+    if (availableBytes == 0) {
+        rxCheckEop(nowTime);
+    }
+
+    // === STEP 2 : Process all RX Data available at the beginning of the burst ===
+    while (processedBytes < availableBytes) {
+        incomingByte = rxReadByte(nowTime);
+        processedBytes++;
+
+        if (!rxProcessByte(incomingByte)) break;
+    }
+
+    return processedBytes;
+}
+
+/*
+ * Checks the received telegram against the recently delivered ones
+ *
+ * Only telegrams flagged as repeated can be duplicates. All others are remembered
+ * as recently delivered, replacing the oldest entry.
+ */
+boolean KnxTpUart::rxIsDuplicate(word nowTime) {
+    TpUartRxRecent *recent;
+    byte hash;
+    word sourceAddr, targetAddr;
+    boolean repeated;
+
+    // the checksum covers all bytes, without the control field it does not depend on the repeat flag
+    if (_rx.extended) {
+        hash = _rx.extTelegram->getChecksum() ^ _rx.extTelegram->getRawByte(0);
+        sourceAddr = _rx.extTelegram->getSourceAddress();
+        targetAddr = _rx.extTelegram->getTargetAddress();
+        repeated = _rx.extTelegram->isRepeated();
+    } else {
+        hash = _rx.receivedTelegram->getChecksum() ^ _rx.receivedTelegram->getRawByte(0);
+        sourceAddr = _rx.receivedTelegram->getSourceAddress();
+        targetAddr = _rx.receivedTelegram->getTargetAddress();
+        repeated = _rx.receivedTelegram->isRepeated();
+    }
+
+    if (repeated) {
+        for (byte i = 0; i < KNX_RX_DUPLICATE_CACHE_SIZE; i++) {
+            recent = &_rx.recent[i];
+
+            if ((recent->hash == hash) && (recent->targetAddr == targetAddr) && (recent->sourceAddr == sourceAddr) &&
+                (TimeDeltaWord(nowTime, recent->timeMillisec) < KNX_RX_DUPLICATE_WINDOW)) {
+                return true;
+            }
         }
     }
 
-    // === STEP 2 : Get New RX Data ===
-    if (_serial.available() > 0) {
-        incomingByte = (byte)(_serial.read());        
-        lastByteRxTimeMicrosec = micros();
+    recent = &_rx.recent[_rx.recentIndex];
+    recent->sourceAddr = sourceAddr;
+    recent->targetAddr = targetAddr;
+    recent->hash = hash;
+    recent->timeMillisec = nowTime;
+    _rx.recentIndex = (_rx.recentIndex + 1) % KNX_RX_DUPLICATE_CACHE_SIZE;
 
-        DEBUG5_PRINTLN(F("RX:  incomingByte=0x%02x, readBytesNb=%d, state=%d"), incomingByte, _rx.readBytes, _rx.state);
+    return false;
+}
 
-        switch (_rx.state) {
-            case RX_IDLE_WAITING_FOR_CTRL_FIELD:
-                DEBUG5_PRINTLN(F("RX_IDLE_WAITING_FOR_CTRL_FIELD \nincomingByte=0x%02x, readBytes=%d"), incomingByte, _rx.readBytes);
+// The extended slot is allocated with the control field of the first extended frame, it is
+// free again once the application got its telegram. Without memory for it the frame gets BUSY.
+boolean KnxTpUart::rxExtSlotAvailable(void) {
+    return (_rx.extTelegram != NULL) && !_rx.extTelegramReceived;
+}
 
-                // CASE OF KNX MESSAGE
-                if ((incomingByte & KNX_CONTROL_FIELD_PATTERN_MASK) == KNX_CONTROL_FIELD_VALID_PATTERN) {
-                    _rx.state = RX_KNX_TELEGRAM_RECEPTION_STARTED;
-                    _rx.readBytes = 1;
-                    telegram.setRawByte(incomingByte, 0);
-                    
-                    DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_STARTED"));
+// Finishes the telegram being received if the line was silent for longer than the EOP gap
+void KnxTpUart::rxCheckEop(unsigned long timeMicrosec) {
+    if ((_busmon != NULL) && _busmon->capturing &&
+        (TimeDeltaUnsignedLong(timeMicrosec, _rx.lastByteTimeMicrosec) > _rx.eopGapMicrosec)) {
+        busmonFinished();
+    }
+
+    if ((_rx.state >= RX_KNX_TELEGRAM_RECEPTION_STARTED) && 
+        (TimeDeltaUnsignedLong(timeMicrosec, _rx.lastByteTimeMicrosec) > _rx.eopGapMicrosec)) {
+        DEBUG5_PRINTLN(F("EOP REACHED"));
+        rxTaskFinished();
+    }
+}
+
+/*
+ * Runs the reception state machine for one byte
+ *
+ * Returns false if reception has to be stopped for the rest of the burst.
+ */
+boolean KnxTpUart::rxProcessByte(byte incomingByte) {
+    boolean addressed, available;
+    word sourceAddr, targetAddr;
+    byte maxLength;
+
+    DEBUG5_PRINTLN(F("RX:  incomingByte=0x%02x, readBytesNb=%d, state=%d"), incomingByte, _rx.readBytes, _rx.state);
+
+    // in bus monitor mode every byte is bus traffic, except a reset indication between
+    // frames: no bus frame starts with it, and the TPUART left bus monitor mode
+    if ((_busmon != NULL) && (_busmon->capturing || (incomingByte != TPUART_RESET_INDICATION))) {
+        busmonProcessByte(incomingByte);
+        return true;
+    }
+
+    switch (_rx.state) {
+        case RX_IDLE_WAITING_FOR_CTRL_FIELD:
+            DEBUG5_PRINTLN(F("RX_IDLE_WAITING_FOR_CTRL_FIELD \nincomingByte=0x%02x, readBytes=%d"), incomingByte, _rx.readBytes);
+
+            // CASE OF KNX MESSAGE, standard or extended frame
+            if (((incomingByte & KNX_CONTROL_FIELD_PATTERN_MASK) == KNX_CONTROL_FIELD_VALID_PATTERN) ||
+                ((incomingByte & KNX_CONTROL_FIELD_PATTERN_MASK) == KNX_EXT_CONTROL_FIELD_VALID_PATTERN)) {
+                _rx.state = RX_KNX_TELEGRAM_RECEPTION_STARTED;
+                _rx.extended = ((incomingByte & KNX_CONTROL_FIELD_PATTERN_MASK) == KNX_EXT_CONTROL_FIELD_VALID_PATTERN);
+                _rx.readBytes = 1;
+                _rx.receivedTelegram->setRawByte(incomingByte, 0);
+                _rx.xorSum = incomingByte;
+
+                // allocate here, five characters ahead of the ACK window, not when the ACK is due
+                if (_rx.extended && (_rx.extTelegram == NULL)) {
+                    _rx.extTelegram = new KnxExtTelegram();
+                }
                 
-                // CASE OF TPUART_DATA_CONFIRM_SUCCESS NOTIFICATION
-                } else if (incomingByte == TPUART_DATA_CONFIRM_SUCCESS) {
-                    DEBUG5_PRINTLN(F("TPUART_DATA_CONFIRM_SUCCESS"));
-                    
-                    if (_tx.state == TX_WAITING_ACK) {
-                        _tx.state = TX_IDLE;
-                        
-                    } else {
-                        DEBUG5_PRINTLN(F("Rx: unexpected TPUART_DATA_CONFIRM_SUCCESS received!"));
-                    }
+                DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_STARTED"));
+            
+            // CASE OF TPUART_DATA_CONFIRM_SUCCESS NOTIFICATION
+            } else if (incomingByte == TPUART_DATA_CONFIRM_SUCCESS) {
+                DEBUG5_PRINTLN(F("TPUART_DATA_CONFIRM_SUCCESS"));
                 
-                // CASE OF TPUART_RESET NOTIFICATION
-                } else if (incomingByte == TPUART_RESET_INDICATION) {
-                    _tx.state = TX_STOPPED;
-                    _rx.state = RX_STOPPED;
-                    
-                    // Notify RESET
-                    _evtCallbackFct(TPUART_EVENT_RESET);
-                    
-                    DEBUG5_PRINTLN(F("Rx: Reset Indication Received"));
+                if (_tx.state == TX_WAITING_ACK) {
+                    _evtCallbackFct(TPUART_EVENT_KNX_TELEGRAM_SENT);
+                    txDone();
                     
-                    return;
+                } else {
+                    DEBUG5_PRINTLN(F("Rx: unexpected TPUART_DATA_CONFIRM_SUCCESS received!"));
+                }
+            
+            // CASE OF TPUART_RESET NOTIFICATION
+            } else if (incomingByte == TPUART_RESET_INDICATION) {
+                _tx.state = TX_STOPPED;
+                _rx.state = RX_STOPPED;
                 
-                // CASE OF STATE_INDICATION RESPONSE
-                } else if ((incomingByte & TPUART_STATE_INDICATION_MASK) == TPUART_STATE_INDICATION) {
-                    DEBUG5_PRINTLN(F("Rx: State Indication Received"));
+                // Notify RESET
+                _evtCallbackFct(TPUART_EVENT_RESET);
                 
-                // CASE OF TPUART_DATA_CONFIRM_FAILED NOTIFICATION
-                } else if (incomingByte == TPUART_DATA_CONFIRM_FAILED) {
-                    DEBUG5_PRINTLN(F("TPUART_DATA_CONFIRM_FAILED"));
-                    
-                    // NACK following Telegram transmission
-                    if (_tx.state == TX_WAITING_ACK) {
-                        _tx.state = TX_IDLE;
-                        
-                    } else {
-                        DEBUG5_PRINTLN(F("Rx: unexpected TPUART_DATA_CONFIRM_FAILED received!"));
-                    }
+                DEBUG5_PRINTLN(F("Rx: Reset Indication Received"));
                 
-                // UNKNOWN CONTROL FIELD RECEIVED
-                } else if (incomingByte) {
-                    DEBUG5_PRINTLN(F("Rx: Unknown Control Field received: byte=0x%02x"), incomingByte);
-                }
+                return false;
+            
+            // CASE OF STATE_INDICATION RESPONSE
+            } else if ((incomingByte & TPUART_STATE_INDICATION_MASK) == TPUART_STATE_INDICATION) {
+                DEBUG5_PRINTLN(F("Rx: State Indication Received"));
+            
+            // CASE OF TPUART_DATA_CONFIRM_FAILED NOTIFICATION
+            } else if (incomingByte == TPUART_DATA_CONFIRM_FAILED) {
+                DEBUG5_PRINTLN(F("TPUART_DATA_CONFIRM_FAILED"));
                 
-                // else ignore "0" value sent on Reset by TPUART prior to TPUART_RESET_INDICATION
-                break;
+                // NACK following Telegram transmission
+                if (_tx.state == TX_WAITING_ACK) {
+                    txFailed();
+                    
+                } else {
+                    DEBUG5_PRINTLN(F("Rx: unexpected TPUART_DATA_CONFIRM_FAILED received!"));
+                }
+            
+            // UNKNOWN CONTROL FIELD RECEIVED
+            } else if (incomingByte) {
+                DEBUG5_PRINTLN(F("Rx: Unknown Control Field received: byte=0x%02x"), incomingByte);
+            }
+            
+            // else ignore "0" value sent on Reset by TPUART prior to TPUART_RESET_INDICATION
+            break;
 
-            case RX_KNX_TELEGRAM_RECEPTION_STARTED:
-                DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_STARTED incomingByte=0x%02x, readBytesNb=%d"), incomingByte, _rx.readBytes);
-                
-                telegram.setRawByte(incomingByte, _rx.readBytes);
-                _rx.readBytes++;
+        case RX_KNX_TELEGRAM_RECEPTION_STARTED:
+            DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_STARTED incomingByte=0x%02x, readBytesNb=%d"), incomingByte, _rx.readBytes);
+            
+            _rx.receivedTelegram->setRawByte(incomingByte, _rx.readBytes);
+            _rx.xorSum ^= incomingByte;
+            _rx.readBytes++;
+
+            // here the control, source and target address byte have been read
+            if (_rx.readBytes == 6) { 
+                if (_rx.extended) {
+                    // the extended control field shifts the addresses by one, the length follows them
+                    sourceAddr = word(_rx.receivedTelegram->getRawByte(2) << 8) + _rx.receivedTelegram->getRawByte(3);
+                    targetAddr = word(_rx.receivedTelegram->getRawByte(4) << 8) + _rx.receivedTelegram->getRawByte(5);
+                    _rx.expectedLength = 255;
+                } else {
+                    sourceAddr = _rx.receivedTelegram->getSourceAddress();
+                    targetAddr = _rx.receivedTelegram->getTargetAddress();
+                    _rx.expectedLength = (incomingByte & KNX_PAYLOAD_LENGTH_MASK) + 7;
+                }
 
-                // here the control, source and target address byte have been read
-                if (_rx.readBytes == 6) { 
-                    expectedTelegramLength = (incomingByte & KNX_PAYLOAD_LENGTH_MASK) + 7;
+                addressed = (sourceAddr != _physicalAddr) && isAddressAssigned(targetAddr);
+                available = _rx.extended ? rxExtSlotAvailable() : (_rx.queue.getItemCount() < KNX_RX_QUEUE_SIZE);
 
-                    if ((telegram.getSourceAddress() != _physicalAddr) && isAddressAssigned(telegram.getTargetAddress())) {
+                if (addressed && !available) {
 
-                        // sent the correct ACK service now
-                        // the ACK info must be sent latest 1,7 ms after receiving the address type octet of an addressed frame
-                        _serial.write(TPUART_RX_ACK_SERVICE_ADDRESSED);
+                    // no slot left for the telegram, let the sender repeat it later
+                    _serial.write(TPUART_RX_ACK_SERVICE_BUSY);
 
-                        DEBUG5_PRINTLN(F("assigned to us: src=0x%04x ga=0x%04x"), telegram.getSourceAddress(), telegram.getTargetAddress());
+                    DEBUG5_PRINTLN(F("rx queue full: ga=0x%04x"), targetAddr);
 
-                        _rx.state = RX_KNX_TELEGRAM_RECEPTION_ADDRESSED;
+                    if (_rx.queueOverflowCount < 255) _rx.queueOverflowCount++;
+                    _rx.state = RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED;
 
-                        // dirty workaround for sending ACk just before reset?
-                        // _serial.flush();
+                } else if (addressed) {
 
-                    } else {
-                      
-                        // sent the correct ACK service now
-                        // the ACK info must be sent latest 1,7 ms after receiving the address type octet of an addressed frame
-                        _serial.write(TPUART_RX_ACK_SERVICE_NOT_ADDRESSED);
+                    // sent the correct ACK service now
+                    // the ACK info must be sent latest 1,7 ms after receiving the address type octet of an addressed frame
+                    _serial.write(TPUART_RX_ACK_SERVICE_ADDRESSED);
 
-                        DEBUG5_PRINTLN(F("not assigned to us: ga=0x%04x"), telegram.getTargetAddress());
-                        
-                        _rx.state = RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED;
+                    DEBUG5_PRINTLN(F("assigned to us: src=0x%04x ga=0x%04x"), sourceAddr, targetAddr);
 
-                        // dirty workaround for sending ACk just before reset?
-                        // _serial.flush();
-                    }
+                    _rx.state = RX_KNX_TELEGRAM_RECEPTION_ADDRESSED;
 
-                    DEBUG5_PRINTLN(F("Size: %d %d"), telegram.getTelegramLength(), telegram.getPayloadLength());
-                }
-                break;
+                    // move the header collected so far to the extended slot
+                    if (_rx.extended) {
+                        for (byte i = 0; i < _rx.readBytes; i++) {
+                            _rx.extTelegram->setRawByte(_rx.receivedTelegram->getRawByte(i), i);
+                        }
+                    }
 
-            case RX_KNX_TELEGRAM_RECEPTION_ADDRESSED:
-                DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_ADDRESSED"));
-                
-            case RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED:
-                DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED"));
+                    // dirty workaround for sending ACk just before reset?
+                    // _serial.flush();
 
-                if (_rx.readBytes == KNX_TELEGRAM_MAX_SIZE) {
-                    DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID"));
-                    
-                    _rx.state = RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID;
-                    rxTaskFinished(telegram);
-                    
                 } else {
-                    DEBUG5_PRINTLN(F("expectedTelegramLength: %d, readBytesNb: %d"),expectedTelegramLength, _rx.readBytes);
-                    
-                    if (_rx.state == RX_KNX_TELEGRAM_RECEPTION_ADDRESSED) {
-                        telegram.setRawByte(incomingByte, _rx.readBytes);
-                    }
+                  
+                    // sent the correct ACK service now
+                    // the ACK info must be sent latest 1,7 ms after receiving the address type octet of an addressed frame
+                    _serial.write(TPUART_RX_ACK_SERVICE_NOT_ADDRESSED);
+
+                    DEBUG5_PRINTLN(F("not assigned to us: ga=0x%04x"), targetAddr);
                     
-                    if (expectedTelegramLength == _rx.readBytes) {                        
-                        DEBUG5_PRINTLN(F("we are done, telegramCompletelyReceived"));
+                    _rx.state = RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED;
+
+                    // dirty workaround for sending ACk just before reset?
+                    // _serial.flush();
+                }
+
+                DEBUG5_PRINTLN(F("Size: %d"), _rx.expectedLength);
+            }
+            break;
 
-                        rxTaskFinished(telegram);
-                        
+        case RX_KNX_TELEGRAM_RECEPTION_ADDRESSED:
+            DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_ADDRESSED"));
+            
+        case RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED:
+            DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED"));
+
+            maxLength = _rx.extended ? KNX_EXT_TELEGRAM_MAX_SIZE : KNX_TELEGRAM_MAX_SIZE;
+
+            if (_rx.readBytes == maxLength) {
+                DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID"));
+                
+                _rx.state = RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID;
+                rxTaskFinished();
+                
+            } else {
+                DEBUG5_PRINTLN(F("expectedLength: %d, readBytesNb: %d"),_rx.expectedLength, _rx.readBytes);
+                
+                if (_rx.state == RX_KNX_TELEGRAM_RECEPTION_ADDRESSED) {
+                    if (_rx.extended) {
+                        _rx.extTelegram->setRawByte(incomingByte, _rx.readBytes);
                     } else {
-                        _rx.readBytes++;
+                        _rx.receivedTelegram->setRawByte(incomingByte, _rx.readBytes);
                     }
+                    _rx.xorSum ^= incomingByte;
                 }
-                break;
 
-            // if the message is too long, just read until expected length
-            case RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID:
-                _rx.readBytes++;
-                break;
+                // length field of an extended frame, too long frames run into maxLength
+                if (_rx.extended && (_rx.readBytes == KNX_EXT_TELEGRAM_HEADER_SIZE - 1)) {
+                    _rx.expectedLength = (incomingByte <= maxLength - KNX_EXT_TELEGRAM_LENGTH_OFFSET) ?
+                                         incomingByte + KNX_EXT_TELEGRAM_LENGTH_OFFSET - 1 : 255;
+                }
+                
+                if (_rx.expectedLength == _rx.readBytes) {                        
+                    DEBUG5_PRINTLN(F("we are done, telegramCompletelyReceived"));
 
-            default:
-                break;
-        }
+                    rxTaskFinished();
+                    
+                } else {
+                    _rx.readBytes++;
+                }
+            }
+            break;
+
+        // if the message is too long, just read until expected length
+        case RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID:
+            _rx.readBytes++;
+            break;
+
+        default:
+            break;
+    }
+
+    return true;
+}
+
+#ifdef KNX_RX_ISR
+/*
+ * Interrupt part of the reception
+ *
+ * Call this from the UART RX interrupt or from a timer interrupt firing at least
+ * every 2 ms. Moves all bytes received by the serial into the rx ring together with
+ * their arrival time, so reception does not depend on how often task() is called.
+ */
+void KnxTpUart::rxIsr(void) {
+    TpUartRxByte rxByte;
+
+    // reset() and init() use the serial directly
+    if (_rx.state < RX_IDLE_WAITING_FOR_CTRL_FIELD) return;
+
+    while (_serial.available() > 0) {
+        rxByte.data = (byte)(_serial.read());
+        rxByte.timeMicrosec = micros();
+
+        // on overflow the byte is lost, the running telegram will fail on checksum or EOP
+        _rxRing.push(rxByte);
     }
 }
 
-void KnxTpUart::rxTaskFinished(KnxTelegram telegram) {
+byte KnxTpUart::rxAvailable(void) {
+    return _rxRing.getItemCount();
+}
+
+// only call if rxAvailable said so, takes the arrival time from the ring instead of the burst time
+byte KnxTpUart::rxReadByte(unsigned long) {
+    TpUartRxByte rxByte = { 0, 0 };
+
+    _rxRing.pop(rxByte);
+
+    // arrival times are exact here, so a gap in front of this byte ends the
+    // telegram being received and the byte itself may start the next one
+    rxCheckEop(rxByte.timeMicrosec);
+    _rx.lastByteTimeMicrosec = rxByte.timeMicrosec;
+
+    return rxByte.data;
+}
+
+#else
+
+byte KnxTpUart::rxAvailable(void) {
+    int available = _serial.available();
+
+    return (available > 255) ? 255 : (byte)available;
+}
+
+// only call if rxAvailable said so, all bytes of a burst share the burst time,
+// so EOP can only be detected between bursts
+byte KnxTpUart::rxReadByte(unsigned long burstTimeMicrosec) {
+    _rx.lastByteTimeMicrosec = burstTimeMicrosec;
+
+    return (byte)(_serial.read());
+}
+
+#endif
+
+void KnxTpUart::rxTaskFinished(void) {
   
     switch (_rx.state) {
 
@@ -338,11 +579,27 @@ void KnxTpUart::rxTaskFinished(KnxTelegram telegram) {
             break;
 
         case RX_KNX_TELEGRAM_RECEPTION_ADDRESSED:
-            DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_ADDRESSED ga=0x%04x"), telegram.getTargetAddress());
+            DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_ADDRESSED"));
             
-            if (telegram.isChecksumCorrect()) {
-                telegram.copy(_rx.receivedTelegram);
-                _evtCallbackFct(TPUART_EVENT_RECEIVED_KNX_TELEGRAM);
+            // the XOR of all bytes including a correct checksum is always 0xFF
+            if (_rx.xorSum == 0xFF) {
+                // a sender missing our ACK repeats the telegram, it was delivered already
+                if (rxIsDuplicate((word)millis())) {
+                    DEBUG5_PRINTLN(F("duplicate dropped"));
+
+                    if (_rx.duplicateCount < 255) _rx.duplicateCount++;
+                    break;
+                }
+
+                if (_rx.extended) {
+                    _rx.extTelegramReceived = true;
+                    break;
+                }
+
+                // only enqueue, the application gets it later outside of the byte level loop
+                _rx.queue.commit();
+                _rx.receivedTelegram = _rx.queue.reserve();
+                if (_rx.queue.getItemCount() > _rx.queueMaxCount) _rx.queueMaxCount = _rx.queue.getItemCount();
                 
             } else {
                 DEBUG5_PRINTLN(F("checksum incorrect."));
@@ -352,8 +609,8 @@ void KnxTpUart::rxTaskFinished(KnxTelegram telegram) {
             break;
 
         case RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED:
-            DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED ga=0x%04x"), telegram.getTargetAddress());
-            
+            DEBUG5_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED"));
+
             break;
 
         default:
@@ -365,12 +622,138 @@ void KnxTpUart::rxTaskFinished(KnxTelegram telegram) {
     _rx.readBytes = 0;
 }
 
+/*
+ * Bus monitor mode
+ *
+ * The TPUART forwards all bus traffic without acknowledging anything and only
+ * leaves this mode on reset. Every frame is captured with its arrival time into
+ * a ring of KNX_BUSMON_RING_SIZE records, readBusmonFrame streams them out.
+ */
+byte KnxTpUart::activateBusmon(void) {
+    if ((_rx.state != RX_IDLE_WAITING_FOR_CTRL_FIELD) || (_tx.state != TX_IDLE)) {
+        return KNX_TPUART_ERROR_NOT_INIT_STATE;
+    }
+
+    _busmon = new TpUartBusmon();
+    if (_busmon == NULL) return KNX_TPUART_ERROR;
+
+    _serial.write(TPUART_ACTIVATEBUSMON_REQ);
+
+    // nothing must be sent until the next reset
+    _tx.state = TX_STOPPED;
+
+    DEBUG0_PRINTLN(F("Bus monitor mode started"));
+
+    return KNX_TPUART_OK;
+}
+
+void KnxTpUart::busmonProcessByte(byte incomingByte) {
+    TpUartBusmonRecord *record;
+
+    if (!_busmon->capturing) {
+        _busmon->capturing = true;
+        record = _busmon->records.reserve();
+        _busmon->dropping = (record == NULL);
+        _busmon->readBytes = 0;
+        _busmon->expectedLength = 0;
+        _busmon->xorSum = 0;
+
+        if (_busmon->dropping) {
+            _busmon->overflow = true;
+        } else {
+            record->timeMicrosec = _rx.lastByteTimeMicrosec;
+            record->flags = _busmon->overflow ? KNX_BUSMON_FLAG_OVERFLOW : 0;
+            record->length = 0;
+            _busmon->overflow = false;
+        }
+
+        // everything not starting with a control field, like ACK frames, is a single byte
+        if (((incomingByte & KNX_CONTROL_FIELD_PATTERN_MASK) != KNX_CONTROL_FIELD_VALID_PATTERN) &&
+            ((incomingByte & KNX_CONTROL_FIELD_PATTERN_MASK) != KNX_EXT_CONTROL_FIELD_VALID_PATTERN)) {
+            _busmon->expectedLength = 1;
+        }
+    }
+
+    _busmon->xorSum ^= incomingByte;
+
+    if (!_busmon->dropping) {
+        record = _busmon->records.reserve();
+
+        if (record->length < KNX_TELEGRAM_MAX_SIZE) {
+            record->data[record->length++] = incomingByte;
+        } else {
+            record->flags |= KNX_BUSMON_FLAG_TRUNCATED;
+        }
+        _busmon->readBytes++;
+
+        // the routing or length field tells the length, so the following ACK frame gets its own record
+        if ((_busmon->readBytes == KNX_TELEGRAM_HEADER_SIZE) &&
+            ((record->data[0] & KNX_CONTROL_FIELD_PATTERN_MASK) == KNX_CONTROL_FIELD_VALID_PATTERN)) {
+            _busmon->expectedLength = (incomingByte & KNX_PAYLOAD_LENGTH_MASK) + KNX_TELEGRAM_LENGTH_OFFSET;
+
+        } else if ((_busmon->readBytes == KNX_EXT_TELEGRAM_HEADER_SIZE) &&
+                   ((record->data[0] & KNX_CONTROL_FIELD_PATTERN_MASK) == KNX_EXT_CONTROL_FIELD_VALID_PATTERN)) {
+            _busmon->expectedLength = (incomingByte <= 255 - KNX_EXT_TELEGRAM_LENGTH_OFFSET) ?
+                                      incomingByte + KNX_EXT_TELEGRAM_LENGTH_OFFSET : 255;
+        }
+
+        if (_busmon->readBytes == _busmon->expectedLength) {
+            busmonFinished();
+        }
+    }
+}
+
+void KnxTpUart::busmonFinished(void) {
+    TpUartBusmonRecord *record;
+
+    if (!_busmon->dropping) {
+        record = _busmon->records.reserve();
+
+        if ((_busmon->expectedLength > 1) && (_busmon->readBytes == _busmon->expectedLength) && (_busmon->xorSum == 0xFF)) {
+            record->flags |= KNX_BUSMON_FLAG_CHECKSUM_OK;
+        }
+
+        _busmon->records.commit();
+    }
+
+    _busmon->capturing = false;
+}
+
+// Writes the oldest captured record framed into buffer, returns the frame length or 0 if there is none
+byte KnxTpUart::readBusmonFrame(byte buffer[], byte bufferSize) {
+    TpUartBusmonRecord *record;
+
+    if (_busmon == NULL) return 0;
+
+    record = _busmon->records.peek();
+    if ((record == NULL) || (bufferSize < KNX_BUSMON_FRAME_HEADER_SIZE + record->length)) return 0;
+
+    buffer[0] = KNX_BUSMON_FRAME_SYNC;
+    buffer[1] = record->flags;
+    buffer[2] = byte(record->timeMicrosec >> 24);
+    buffer[3] = byte(record->timeMicrosec >> 16);
+    buffer[4] = byte(record->timeMicrosec >> 8);
+    buffer[5] = byte(record->timeMicrosec);
+    buffer[6] = record->length;
+    memcpy(&buffer[KNX_BUSMON_FRAME_HEADER_SIZE], record->data, record->length);
+
+    _busmon->records.drop();
+
+    return KNX_BUSMON_FRAME_HEADER_SIZE + record->length;
+}
+
 /**
  * Transmission task
+ *
+ * Never waits for the serial: it only tops up the serial buffer with the next control and
+ * data byte pairs and returns, the UART interrupt sends them. Call it until the state
+ * leaves TX_TELEGRAM_SENDING_ONGOING.
  */
 void KnxTpUart::txTask(void) {
     word nowTime;
     byte txByte[2];
+    int pendingBytes, serialFree;
+    word backoff;
     static word sentMessageTimeMillisec;
 
     switch (_tx.state) {
@@ -381,29 +764,60 @@ void KnxTpUart::txTask(void) {
             
             if (TimeDeltaWord(nowTime, sentMessageTimeMillisec) > KNX_TX_TIMEOUT) {
                 DEBUG5_PRINTLN(F("TX_WAITING_ACK Timeout"));
-                _tx.state = TX_IDLE;
+                txFailed();
+            }
+            break;
+
+        // STEP 1b : repeat a failed telegram once the bus was idle for the backoff time
+        case TX_RETRY_WAIT:
+            nowTime = (word)millis();
+            backoff = KNX_TX_RETRY_BACKOFF;
+            for (byte i = 1; (i < _tx.retries) && (backoff < KNX_TX_RETRY_BACKOFF_MAX); i++) backoff <<= 1;
+            backoff = min(backoff, KNX_TX_RETRY_BACKOFF_MAX);
+
+            if ((_rx.state == RX_IDLE_WAITING_FOR_CTRL_FIELD) &&
+                (TimeDeltaWord(nowTime, _tx.retryTimeMillisec) >= backoff) &&
+                (TimeDeltaUnsignedLong(micros(), _rx.lastByteTimeMicrosec) >= backoff * 1000UL)) {
+                DEBUG5_PRINTLN(F("repeating telegram, retry %d"), _tx.retries);
+
+                _tx.bytesRemaining = (_tx.sentExtTelegram != NULL) ? _tx.sentExtTelegram->getTelegramLength() :
+                                                                     _tx.sentTelegram->getTelegramLength();
+                _tx.txByteIndex = 0;
+                _tx.state = TX_TELEGRAM_SENDING_ONGOING;
             }
             break;
 
         // STEP 2 : send message if any to send
         case TX_TELEGRAM_SENDING_ONGOING:                
-            if (_rx.state == RX_IDLE_WAITING_FOR_CTRL_FIELD) {                
-                
-                // send all available tx bytes at once
-                DEBUG5_PRINTLN(F("sending %d bytes index %d"),_tx.bytesRemaining, _tx.txByteIndex);
-                while (_tx.bytesRemaining > 0) {
+            // a started telegram is finished even if reception starts meanwhile, ACKs are
+            // written in between the byte pairs
+            if ((_rx.state == RX_IDLE_WAITING_FOR_CTRL_FIELD) || (_tx.txByteIndex > 0)) {
+
+                // bytes still in the serial buffer, counted against its free space when empty
+                serialFree = _serial.availableForWrite();
+                if (serialFree > _tx.serialFreeMax) _tx.serialFreeMax = serialFree;
+                pendingBytes = _tx.serialFreeMax - serialFree;
+
+                DEBUG5_PRINTLN(F("sending %d bytes index %d pending %d"),_tx.bytesRemaining, _tx.txByteIndex, pendingBytes);
+                while ((_tx.bytesRemaining > 0) && (pendingBytes + 2 <= KNX_TX_PENDING_MAX)) {
                     txByte[0] = ((_tx.bytesRemaining == 1) ? TPUART_DATA_END_REQ : TPUART_DATA_START_CONTINUE_REQ) + _tx.txByteIndex;
-                    txByte[1] = _tx.sentTelegram->getRawByte(_tx.txByteIndex);
+                    txByte[1] = (_tx.sentExtTelegram != NULL) ? _tx.sentExtTelegram->getRawByte(_tx.txByteIndex) :
+                                                                _tx.sentTelegram->getRawByte(_tx.txByteIndex);
                     
                     DEBUG5_PRINTLN(F("data [%d / %d]= %02x %02x"),_tx.txByteIndex, _tx.bytesRemaining, txByte[0], txByte[1]);
                     
+                    if ((_tx.txByteIndex == 0) && (_tx.retries == 0)) _tx.startTimeMicrosec = micros();
+
                     _serial.write(txByte, 2);  // write the UART control field and the data byte
                     _tx.txByteIndex++;
                     _tx.bytesRemaining--;
+                    pendingBytes += 2;
                 };
 
-                sentMessageTimeMillisec = (word)millis();
-                _tx.state = TX_WAITING_ACK;
+                if (_tx.bytesRemaining == 0) {
+                    sentMessageTimeMillisec = (word)millis();
+                    _tx.state = TX_WAITING_ACK;
+                }
             }
             break;
 
@@ -412,32 +826,125 @@ void KnxTpUart::txTask(void) {
     }
 }
 
-boolean KnxTpUart::isAddressAssigned(word addr) {
-    DEBUG5_PRINTLN(F("isAddressAssigned: Searching for 0x%04x %d"), addr, _groupAddressListSize);
-  
-    for (byte i = 0; i < _groupAddressListSize; i++) {
-        DEBUG5_PRINTLN(F("isAddressAssigned: check 0x%04x"), _groupAddressList[i]);
-      
-        if ( _groupAddressList[i] == addr) {
-            DEBUG5_PRINTLN(F("isAddressAssigned: found 0x%04x"), addr);
-            return true;
+/*
+ * The telegram sent was not confirmed
+ *
+ * It is repeated with the repeat flag set, so receivers that got it already can drop
+ * it, until maxRetries is reached. Then it is reported to the application.
+ */
+void KnxTpUart::txFailed(void) {
+    if (_tx.retries < _tx.maxRetries) {
+        _tx.retries++;
+        _tx.retryTimeMillisec = (word)millis();
+        _tx.state = TX_RETRY_WAIT;
+
+        // the setters patch the checksum
+        if (_tx.sentExtTelegram != NULL) {
+            _tx.sentExtTelegram->setRepeated();
+        } else {
+            _tx.sentTelegram->setRepeated();
         }
+
+    } else {
+        DEBUG5_PRINTLN(F("sending failed ga=0x%04x"), getSentTargetAddress());
+
+        _evtCallbackFct(TPUART_EVENT_KNX_TELEGRAM_SEND_FAILED);
+        txDone();
+    }
+}
+
+// The telegram sent is finished, the prepared one goes out right away
+void KnxTpUart::txDone(void) {
+    if (_tx.nextTelegram == NULL) {
+        _tx.state = TX_IDLE;
+        return;
     }
 
-    return false;
+    _tx.sentTelegram = _tx.nextTelegram;
+    _tx.sentExtTelegram = NULL;
+    _tx.nextTelegram = NULL;
+    _tx.bytesRemaining = _tx.sentTelegram->getTelegramLength();
+    _tx.txByteIndex = 0;
+    _tx.retries = 0;
+    _tx.maxRetries = _tx.nextMaxRetries;
+    _tx.state = TX_TELEGRAM_SENDING_ONGOING;
+}
+
+/*
+ * Binary search on the sorted group address list in PROGMEM
+ *
+ * Runs in the 1,7 ms ACK window, so keep it small: the loop always halves the
+ * remaining range, no matter if and where the address is found.
+ */
+boolean KnxTpUart::isAddressAssigned(word addr) const {
+    const word *base = _groupAddressList;
+    word count = _groupAddressListSize;
+
+    if (count == 0) return false;
+
+    while (count > 1) {
+        word half = count >> 1;
+        if (pgm_read_word(base + half) <= addr) base += half;
+        count -= half;
+    }
+
+    return (pgm_read_word(base) == addr);
 }
 
 // Send a KNX telegram
-byte KnxTpUart::sendTelegram(KnxTelegram& sentTelegram) {
+byte KnxTpUart::sendTelegram(KnxTelegram& sentTelegram, byte maxRetries) {
     DEBUG5_PRINTLN(F("sendTelegram ga=0x%04x"), sentTelegram.getTargetAddress());
     
+    // the setter patches the checksum
     sentTelegram.setSourceAddress(_physicalAddr);
-    sentTelegram.updateChecksum();
     
     _tx.sentTelegram = &sentTelegram;
+    _tx.sentExtTelegram = NULL;
     _tx.bytesRemaining = sentTelegram.getTelegramLength();
     _tx.txByteIndex = 0;
+    _tx.retries = 0;
+    _tx.maxRetries = maxRetries;
     _tx.state = TX_TELEGRAM_SENDING_ONGOING;
                 
     return KNX_TPUART_OK;
 }
+
+// Send an extended KNX telegram, the TPUART limits it to KNX_TPUART_TX_MAX_SIZE bytes
+byte KnxTpUart::sendTelegram(KnxExtTelegram& sentTelegram, byte maxRetries) {
+    DEBUG5_PRINTLN(F("sendTelegram extended ga=0x%04x"), sentTelegram.getTargetAddress());
+
+    if (sentTelegram.getTelegramLength() > KNX_TPUART_TX_MAX_SIZE) return KNX_TPUART_ERROR;
+
+    // the setter patches the checksum
+    sentTelegram.setSourceAddress(_physicalAddr);
+
+    _tx.sentTelegram = NULL;
+    _tx.sentExtTelegram = &sentTelegram;
+    _tx.bytesRemaining = sentTelegram.getTelegramLength();
+    _tx.txByteIndex = 0;
+    _tx.retries = 0;
+    _tx.maxRetries = maxRetries;
+    _tx.state = TX_TELEGRAM_SENDING_ONGOING;
+
+    return KNX_TPUART_OK;
+}
+
+/*
+ * Prepares the telegram to be sent after the one on the bus
+ *
+ * The telegram is stamped now, so it only has to be streamed once the current one is
+ * confirmed or failed. It must stay untouched until it is sent, see isReadyForNext.
+ */
+byte KnxTpUart::sendNextTelegram(KnxTelegram& nextTelegram, byte maxRetries) {
+    if (!isReadyForNext()) return KNX_TPUART_ERROR;
+
+    DEBUG5_PRINTLN(F("sendNextTelegram ga=0x%04x"), nextTelegram.getTargetAddress());
+
+    // the setter patches the checksum
+    nextTelegram.setSourceAddress(_physicalAddr);
+
+    _tx.nextMaxRetries = maxRetries;
+    _tx.nextTelegram = &nextTelegram;
+
+    return KNX_TPUART_OK;
+}
@@ -46,6 +46,9 @@
 #include <Arduino.h>
 #include <HardwareSerial.h>
 #include "KnxTelegram.h"
+#include "KnxExtTelegram.h"
+#include "RingBuff.h"
+#include "SpscRingBuff.h"
 
 // Values returned by the KnxTpUart member functions :
 #define KNX_TPUART_OK                            0
@@ -61,6 +64,7 @@
 #define TPUART_ACTIVATEBUSMON_REQ            0x05
 #define TPUART_RX_ACK_SERVICE_ADDRESSED      0x11
 #define TPUART_RX_ACK_SERVICE_NOT_ADDRESSED  0x10
+#define TPUART_RX_ACK_SERVICE_BUSY           0x13
 
 // Services from TPUART (TPUART -> hostcontroller) :
 #define TPUART_RESET_INDICATION               0x03
@@ -70,6 +74,7 @@
 #define TPUART_STATE_INDICATION_MASK          0x07
 #define KNX_CONTROL_FIELD_PATTERN_MASK   0b11010011 // 0xD3
 #define KNX_CONTROL_FIELD_VALID_PATTERN  0b10010000 // 0x90
+#define KNX_EXT_CONTROL_FIELD_VALID_PATTERN 0b00010000 // 0x10
 #define KNX_PAYLOAD_LENGTH_MASK          0b00001111 // 0x0F
 
 // Mask for STATE INDICATION service
@@ -80,16 +85,84 @@
 #define TPUART_STATE_INDICATION_TEMP_WARNING_MASK     0x08
 
 // Timeouts
-#define KNX_RX_TIMEOUT 50000 // us
 #define KNX_TX_TIMEOUT 500   // ms
 
+// Repetitions of a telegram not confirmed by the TPUART, after waiting for the bus to be idle
+// for the backoff time. The backoff doubles with every repetition up to the maximum.
+#ifndef KNX_TX_RETRIES
+#define KNX_TX_RETRIES 2
+#endif
+#ifndef KNX_TX_RETRY_BACKOFF
+#define KNX_TX_RETRY_BACKOFF 20      // ms
+#endif
+#ifndef KNX_TX_RETRY_BACKOFF_MAX
+#define KNX_TX_RETRY_BACKOFF_MAX 160 // ms
+#endif
+
+// txTask streams the telegram through the interrupt driven serial buffer and leaves at most this
+// many bytes in it, so an ACK written by rxTask is sent within the 1,7 ms ACK window (one byte
+// takes 573 us at 19200 baud). Must be at least 2, one control and data byte pair.
+#ifndef KNX_TX_PENDING_MAX
+#define KNX_TX_PENDING_MAX 2
+#endif
+
+// The byte index of the data services has 6 bits, so the TPUART sends at most 64 bytes per frame
+#define KNX_TPUART_TX_MAX_SIZE 64
+
+// End of packet is detected by the gap after the last received byte. The TPUART forwards
+// the bytes at bus speed, 13 bit times per character including the inter character gap.
+#define KNX_BUS_BAUDRATE       9600
+#define KNX_BUS_CHARACTER_BITS 13
+#define KNX_BUS_CHARACTER_TIME ((1000000UL * KNX_BUS_CHARACTER_BITS) / KNX_BUS_BAUDRATE) // 1354 us
+#ifndef KNX_RX_EOP_GAP
+#define KNX_RX_EOP_GAP (2 * KNX_BUS_CHARACTER_TIME) // us
+#endif
+
+// Number of received telegrams waiting for dispatch to the application
+#ifndef KNX_RX_QUEUE_SIZE
+#define KNX_RX_QUEUE_SIZE 4
+#endif
+
+// Repeated telegrams matching one delivered within the window are dropped
+#ifndef KNX_RX_DUPLICATE_CACHE_SIZE
+#define KNX_RX_DUPLICATE_CACHE_SIZE 4
+#endif
+#ifndef KNX_RX_DUPLICATE_WINDOW
+#define KNX_RX_DUPLICATE_WINDOW 1000 // ms
+#endif
+
+// Bus monitor, records of captured frames waiting to be read
+#ifndef KNX_BUSMON_RING_SIZE
+#define KNX_BUSMON_RING_SIZE 4
+#endif
+
+// Bus monitor frame format, as returned by readBusmonFrame (multi byte values are big endian):
+//   Byte 0      | KNX_BUSMON_FRAME_SYNC
+//   Byte 1      | Flags, see below
+//   Byte 2..5   | Arrival time of the first byte in us
+//   Byte 6      | Number n of captured bytes
+//   Byte 7..7+n | Captured bytes as seen on the bus
+#define KNX_BUSMON_FRAME_SYNC        0xA5
+#define KNX_BUSMON_FRAME_HEADER_SIZE 7
+#define KNX_BUSMON_FRAME_MAX_SIZE    (KNX_BUSMON_FRAME_HEADER_SIZE + KNX_TELEGRAM_MAX_SIZE)
+#define KNX_BUSMON_FLAG_CHECKSUM_OK  0x01 // complete telegram with correct checksum
+#define KNX_BUSMON_FLAG_TRUNCATED    0x02 // frame was longer than KNX_TELEGRAM_MAX_SIZE (extended frames), the rest is missing
+#define KNX_BUSMON_FLAG_OVERFLOW     0x04 // frames were lost in front of this one because the ring was full
+
+// Interrupt driven reception, compile with -DKNX_RX_ISR to enable
+#ifndef KNX_RX_ISR_RING_SIZE
+#define KNX_RX_ISR_RING_SIZE 32 // must be a power of two
+#endif
+
 
 // --- Definitions for the RECEPTION  part ----
 // Definition of the TP-UART events sent to the application layer
 enum KnxTpUartEvent { 
     TPUART_EVENT_RESET = 0,                          // 0: reset received from the TPUART device
-    TPUART_EVENT_RECEIVED_KNX_TELEGRAM = 1,          // 1: a new addressed KNX Telegram has been received
+    TPUART_EVENT_RECEIVED_KNX_TELEGRAM = 1,          // 1: not sent anymore, received telegrams are queued, see peekReceivedTelegram
     TPUART_EVENT_KNX_TELEGRAM_RECEPTION_ERROR = 2,   // 2: a new addressed KNX telegram reception failed
+    TPUART_EVENT_KNX_TELEGRAM_SEND_FAILED = 3,       // 3: a telegram was not confirmed after all repetitions
+    TPUART_EVENT_KNX_TELEGRAM_SENT = 4,              // 4: a telegram was confirmed by the TPUART
  };
 
 // RX states
@@ -104,14 +177,65 @@ enum TpUartRxState {
     RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED = 7   // Tegram reception ongoing but not addressed
 };
 
+// Recently delivered telegram, to detect repetitions of it
+typedef struct TpUartRxRecent {
+    word sourceAddr;
+    word targetAddr;
+    byte hash;                         // XOR of all bytes behind the control field
+    word timeMillisec;                 // Reception time
+} TpUartRxRecent;
+
 typedef struct TpUartRx {
     byte readBytes;
+    byte expectedLength;               // Length of the telegram being received, known after 6 bytes
+    byte xorSum;                       // XOR of the bytes stored so far, checksum included
+    unsigned long lastByteTimeMicrosec;// Arrival time of the last processed byte
+    word eopGapMicrosec;               // Silence after which a telegram being received is finished
     bool telegramCompletelyReceived;   // receiving telegram finished
+    boolean extended;                  // The telegram being received is an extended frame
     TpUartRxState state;               // Current TPUART RX state
-    KnxTelegram receivedTelegram;      // Where each received telegram is stored (the content is overwritten on each telegram reception)
+    KnxTelegram *receivedTelegram;     // Where the telegram being received is stored in place, always the reserved queue slot
+
+    // Completed telegrams waiting for dispatch, one extra slot for the telegram being received
+    RingBuff<KnxTelegram, KNX_RX_QUEUE_SIZE + 1> queue;
+    byte queueMaxCount;                // Highest number of completed telegrams seen
+    byte queueOverflowCount;           // Addressed telegrams refused with BUSY because the queue was full (saturates at 255)
+
+    TpUartRxRecent recent[KNX_RX_DUPLICATE_CACHE_SIZE]; // Recently delivered telegrams
+    byte recentIndex;                  // Entry to be replaced next
+    byte duplicateCount;               // Repeated telegrams dropped as already delivered (saturates at 255)
+
+    // Extended frames go to their own slot, allocated with the first one addressed to us.
+    // The header is collected in the queue tail slot until the addressing is known.
+    KnxExtTelegram *extTelegram;
+    boolean extTelegramReceived;       // extTelegram holds a completed telegram waiting for dispatch
 
 } TpUartRx;
 
+// Received byte together with its arrival time, filled by rxIsr
+typedef struct TpUartRxByte {
+    byte data;
+    unsigned long timeMicrosec;
+} TpUartRxByte;
+
+// One frame captured in bus monitor mode
+typedef struct TpUartBusmonRecord {
+    unsigned long timeMicrosec;       // Arrival time of the first byte
+    byte flags;                       // KNX_BUSMON_FLAG_xxx
+    byte length;                      // Number of captured bytes
+    byte data[KNX_TELEGRAM_MAX_SIZE];
+} TpUartBusmonRecord;
+
+typedef struct TpUartBusmon {
+    RingBuff<TpUartBusmonRecord, KNX_BUSMON_RING_SIZE> records; // Completed records, the one being captured is reserved
+    byte readBytes;                   // Number of bytes of the frame being captured, stored or not
+    byte expectedLength;              // Length of the frame being captured, 0 if not known yet
+    byte xorSum;                      // XOR of the bytes captured so far
+    boolean capturing;                // A frame is being captured
+    boolean dropping;                 // The ring is full, the frame being received is dropped
+    boolean overflow;                 // Frames were dropped since the last stored one
+} TpUartBusmon;
+
 // Typedef for events callback function
 typedef void (*EventCallbackFctPtr) (KnxTpUartEvent);
 
@@ -124,14 +248,23 @@ enum TpUartTxState {
     TX_INIT = 2,                      // The TX part is awaiting init execution
     TX_IDLE = 3,                      // Idle, no transmission ongoing
     TX_TELEGRAM_SENDING_ONGOING = 4,  // KNX telegram transmission ongoing
-    TX_WAITING_ACK = 5                // Telegram transmitted, waiting for ACK/NACK
+    TX_WAITING_ACK = 5,               // Telegram transmitted, waiting for ACK/NACK
+    TX_RETRY_WAIT = 6                 // Telegram not confirmed, waiting for the bus to repeat it
 };
 
 typedef struct TpUartTx {
     TpUartTxState state;              // Current TPUART TX state
     KnxTelegram *sentTelegram;        // Telegram being sent
+    KnxExtTelegram *sentExtTelegram;  // Extended telegram being sent instead, if not NULL
     byte bytesRemaining;              // Nb of bytes remaining to be transmitted
     byte txByteIndex;                 // Index of the byte to be sent
+    byte retries;                     // Repetitions done so far
+    byte maxRetries;                  // Repetitions allowed for the telegram being sent
+    word retryTimeMillisec;           // Time of the last failure
+    unsigned long startTimeMicrosec;  // Time the first byte of the first attempt was written
+    KnxTelegram *nextTelegram;        // Telegram prepared while the current one is on the bus, started when it is done
+    byte nextMaxRetries;              // Repetitions allowed for the next telegram
+    int serialFreeMax;                // availableForWrite of the empty serial buffer, the largest value seen
 } TpUartTx;
 
 class KnxTpUart {
@@ -140,37 +273,93 @@ class KnxTpUart {
     TpUartTx _tx;                       
     EventCallbackFctPtr _evtCallbackFct; 
     const word _physicalAddr;                 
-    const word *_groupAddressList;
-    const byte _groupAddressListSize;   
+    const word *_groupAddressList;      // sorted, in PROGMEM
+    const word _groupAddressListSize;   
+    TpUartBusmon *_busmon;              // only allocated in bus monitor mode
+#ifdef KNX_RX_ISR
+    SpscRingBuff<TpUartRxByte, KNX_RX_ISR_RING_SIZE> _rxRing;
+#endif
 
   public:  
-    KnxTpUart(HardwareSerial& serial, word physicalAddr, word groupAddressList[], byte groupAddressListSize);
+    KnxTpUart(HardwareSerial& serial, word physicalAddr, const word groupAddressList[], word groupAddressListSize);
     ~KnxTpUart();
 
     byte init(void);
     byte reset(void);
     byte setEvtCallback(EventCallbackFctPtr);
+    void setRxEopGap(word gapMicrosec);
 
     boolean isActive(void) const;
     boolean isFreeToSend(void) const;
     boolean isRxActive(void) const;    
 
-    void rxTask(void);
+    byte rxTask(void);
     void txTask(void);
 
-    KnxTelegram& getReceivedTelegram(void);
-    byte sendTelegram(KnxTelegram& sentTelegram);
+#ifdef KNX_RX_ISR
+    void rxIsr(void);
+    byte getRxIsrOverflowCount(void) const;
+#endif
+
+    const KnxTelegram* peekReceivedTelegram(void) const;
+    void popReceivedTelegram(void);
+    byte getRxQueueCount(void) const;
+    byte getRxQueueMaxCount(void) const;
+    byte getRxQueueOverflowCount(void) const;
+    byte getRxDuplicateCount(void) const;
+    byte sendTelegram(KnxTelegram& sentTelegram, byte maxRetries = KNX_TX_RETRIES);
+    byte sendNextTelegram(KnxTelegram& nextTelegram, byte maxRetries = KNX_TX_RETRIES);
+    boolean isReadyForNext(void) const;
+    boolean isAddressAssigned(word addr) const;
+
+    const KnxExtTelegram* peekReceivedExtTelegram(void) const;
+    void popReceivedExtTelegram(void);
+    byte sendTelegram(KnxExtTelegram& sentTelegram, byte maxRetries = KNX_TX_RETRIES);
+    boolean isSending(const KnxExtTelegram& sentTelegram) const;
+    word getSentTargetAddress(void) const;
+    const KnxTelegram* getSentTelegram(void) const;
+    unsigned long getSentStartTime(void) const;
+
+    byte activateBusmon(void);
+    boolean isBusmonActive(void) const;
+    byte readBusmonFrame(byte buffer[], byte bufferSize);
 
   private:
-    void rxTaskFinished(KnxTelegram telegram);
-    boolean isAddressAssigned(word addr);
+    byte rxAvailable(void);
+    byte rxReadByte(unsigned long burstTimeMicrosec);
+    void rxCheckEop(unsigned long timeMicrosec);
+    boolean rxProcessByte(byte incomingByte);
+    void rxTaskFinished(void);
+    boolean rxIsDuplicate(word nowTime);
+    boolean rxExtSlotAvailable(void);
+    void txFailed(void);
+    void txDone(void);
+    void busmonProcessByte(byte incomingByte);
+    void busmonFinished(void);
 };
 
 
 // ----- Definition of the INLINED functions :  ------------
-inline KnxTelegram& KnxTpUart::getReceivedTelegram(void) { return _rx.receivedTelegram; }
-inline boolean KnxTpUart::isActive(void) const { return ( _rx.state > RX_IDLE_WAITING_FOR_CTRL_FIELD) || ( _tx.state > TX_IDLE); }
+inline const KnxTelegram* KnxTpUart::peekReceivedTelegram(void) const { return _rx.queue.peek(); }
+inline const KnxExtTelegram* KnxTpUart::peekReceivedExtTelegram(void) const { return _rx.extTelegramReceived ? _rx.extTelegram : NULL; }
+inline void KnxTpUart::popReceivedExtTelegram(void) { _rx.extTelegramReceived = false; }
+inline void KnxTpUart::popReceivedTelegram(void) { _rx.queue.drop(); }
+inline byte KnxTpUart::getRxQueueCount(void) const { return _rx.queue.getItemCount(); }
+inline byte KnxTpUart::getRxQueueMaxCount(void) const { return _rx.queueMaxCount; }
+inline byte KnxTpUart::getRxQueueOverflowCount(void) const { return _rx.queueOverflowCount; }
+inline byte KnxTpUart::getRxDuplicateCount(void) const { return _rx.duplicateCount; }
+inline boolean KnxTpUart::isActive(void) const { return ( _rx.state > RX_IDLE_WAITING_FOR_CTRL_FIELD) || (( _tx.state > TX_IDLE) && ( _tx.state != TX_RETRY_WAIT)); }
 inline boolean KnxTpUart::isFreeToSend(void) const { return ( _rx.state == RX_IDLE_WAITING_FOR_CTRL_FIELD) && ( _tx.state == TX_IDLE); }
 inline boolean KnxTpUart::isRxActive(void) const { return ( _rx.state > RX_IDLE_WAITING_FOR_CTRL_FIELD); }
+inline void KnxTpUart::setRxEopGap(word gapMicrosec) { _rx.eopGapMicrosec = gapMicrosec; }
+inline boolean KnxTpUart::isReadyForNext(void) const { return (( _tx.state == TX_TELEGRAM_SENDING_ONGOING) || ( _tx.state == TX_WAITING_ACK)) && ( _tx.nextTelegram == NULL); }
+inline boolean KnxTpUart::isSending(const KnxExtTelegram& sentTelegram) const { return ( _tx.state > TX_IDLE) && ( _tx.sentExtTelegram == &sentTelegram); }
+inline word KnxTpUart::getSentTargetAddress(void) const { return (_tx.sentExtTelegram != NULL) ? _tx.sentExtTelegram->getTargetAddress() : _tx.sentTelegram->getTargetAddress(); }
+inline const KnxTelegram* KnxTpUart::getSentTelegram(void) const { return (_tx.sentExtTelegram != NULL) ? NULL : _tx.sentTelegram; }
+inline unsigned long KnxTpUart::getSentStartTime(void) const { return _tx.startTimeMicrosec; }
+inline boolean KnxTpUart::isBusmonActive(void) const { return (_busmon != NULL); }
+#ifdef KNX_RX_ISR
+inline byte KnxTpUart::getRxIsrOverflowCount(void) const { return _rxRing.getOverflowCount(); }
+#endif
 
 #endif // KNXTPUART_H
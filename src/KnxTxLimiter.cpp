@@ -0,0 +1,138 @@
+/*
+ *    KnxTxLimiter.cpp
+ *
+ *    Written by Christian Poulter.
+ *
+ *    Copyright (C) 2023 Christian Poulter <devel(at)poulter.de>
+ *    All rights reserved. This file is now part of the Ardunio SimpleKnx Library.
+ *
+ *    The Ardunio SimpleKnx Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "KnxTxLimiter.h"
+#include "KnxTools.h"
+
+KnxTxLimiter::KnxTxLimiter() {
+    initBucket(_global, 0, 1);
+    _gaCount = 0;
+    _lastTimeMillisec = millis();
+}
+
+// Limits all telegrams to rate per second, rate 0 removes the limit
+void KnxTxLimiter::setLimit(byte rate, byte burst) {
+    initBucket(_global, rate, burst);
+}
+
+// Limits the telegrams to groupAddr, returns false if all KNX_TX_LIMIT_GA_SIZE entries are taken
+boolean KnxTxLimiter::setLimit(word groupAddr, byte rate, byte burst) {
+    KnxTokenBucket *bucket = findBucket(groupAddr);
+
+    if (bucket == NULL) {
+        if (_gaCount == KNX_TX_LIMIT_GA_SIZE) return false;
+
+        _groupAddr[_gaCount] = groupAddr;
+        bucket = &_ga[_gaCount++];
+    }
+
+    initBucket(*bucket, rate, burst);
+
+    return true;
+}
+
+void KnxTxLimiter::refill(unsigned long nowTime) {
+    unsigned long elapsed = TimeDeltaUnsignedLong(nowTime, _lastTimeMillisec);
+    if (elapsed == 0) return;
+
+    _lastTimeMillisec = nowTime;
+
+    refillBucket(_global, elapsed);
+    for (byte i = 0; i < _gaCount; i++) {
+        refillBucket(_ga[i], elapsed);
+    }
+}
+
+// Returns true if the global bucket allows a telegram now
+boolean KnxTxLimiter::isAllowed(void) {
+    return checkBucket(_global);
+}
+
+// Returns true if the bucket of groupAddr allows a telegram now
+boolean KnxTxLimiter::isAllowed(word groupAddr) {
+    KnxTokenBucket *bucket = findBucket(groupAddr);
+
+    return (bucket == NULL) || checkBucket(*bucket);
+}
+
+// Takes the tokens for a telegram sent to groupAddr
+void KnxTxLimiter::consume(word groupAddr) {
+    KnxTokenBucket *bucket = findBucket(groupAddr);
+
+    if (_global.rate) _global.tokens -= KNX_TX_LIMIT_TOKEN;
+    _global.throttled = false;
+
+    if (bucket != NULL) {
+        if (bucket->rate) bucket->tokens -= KNX_TX_LIMIT_TOKEN;
+        bucket->throttled = false;
+    }
+}
+
+word KnxTxLimiter::getThrottledCount(word groupAddr) const {
+    for (byte i = 0; i < _gaCount; i++) {
+        if (_groupAddr[i] == groupAddr) return _ga[i].throttledCount;
+    }
+
+    return 0;
+}
+
+KnxTokenBucket* KnxTxLimiter::findBucket(word groupAddr) {
+    for (byte i = 0; i < _gaCount; i++) {
+        if (_groupAddr[i] == groupAddr) return &_ga[i];
+    }
+
+    return NULL;
+}
+
+// tokens are a word, so the burst is limited to 65 telegrams. The product is taken as word,
+// a 16 bit int overflows above 32 telegrams
+void KnxTxLimiter::initBucket(KnxTokenBucket& bucket, byte rate, byte burst) {
+    bucket.rate = rate;
+    bucket.burst = constrain(burst, 1, 65535 / KNX_TX_LIMIT_TOKEN);
+    bucket.tokens = word(bucket.burst) * KNX_TX_LIMIT_TOKEN;
+    bucket.throttled = false;
+    bucket.throttledCount = 0;
+}
+
+void KnxTxLimiter::refillBucket(KnxTokenBucket& bucket, unsigned long elapsed) {
+    word maxTokens = word(bucket.burst) * KNX_TX_LIMIT_TOKEN;
+
+    // a token per ms and telegram per second
+    if ((bucket.rate == 0) || (elapsed >= maxTokens)) {
+        bucket.tokens = maxTokens;
+    } else {
+        bucket.tokens = min((unsigned long)maxTokens, bucket.tokens + elapsed * bucket.rate);
+    }
+}
+
+// counts a throttling once per waiting telegram, not on every check
+boolean KnxTxLimiter::checkBucket(KnxTokenBucket& bucket) {
+    if ((bucket.rate == 0) || (bucket.tokens >= KNX_TX_LIMIT_TOKEN)) return true;
+
+    if (!bucket.throttled) {
+        bucket.throttled = true;
+        if (bucket.throttledCount < 65535) bucket.throttledCount++;
+    }
+
+    return false;
+}
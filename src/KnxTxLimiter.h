@@ -0,0 +1,83 @@
+/*
+ *    KnxTxLimiter.h
+ *
+ *    Written by Christian Poulter.
+ *
+ *    Copyright (C) 2023 Christian Poulter <devel(at)poulter.de>
+ *    All rights reserved. This file is now part of the Ardunio SimpleKnx Library.
+ *
+ *    The Ardunio SimpleKnx Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef KNXTXLIMITER_H
+#define KNXTXLIMITER_H
+
+#include <Arduino.h>
+
+// Number of group addresses with their own rate limit
+#ifndef KNX_TX_LIMIT_GA_SIZE
+#define KNX_TX_LIMIT_GA_SIZE 4
+#endif
+
+#define KNX_TX_LIMIT_TOKEN 1000 // tokens per telegram, so one telegram per second refills a token per ms
+
+typedef struct KnxTokenBucket {
+    byte rate;                         // Telegrams per second, 0 is unlimited
+    byte burst;                        // Telegrams that can be sent back to back
+    word tokens;                       // Available tokens, KNX_TX_LIMIT_TOKEN per telegram
+    boolean throttled;                 // A telegram is waiting for tokens
+    word throttledCount;               // Number of times a telegram had to wait for tokens (saturates at 65535)
+} KnxTokenBucket;
+
+/*
+ * Token bucket rate limiter for outgoing telegrams
+ *
+ * One bucket limits all telegrams, up to KNX_TX_LIMIT_GA_SIZE more limit single
+ * group addresses. Buckets refill with their rate up to their burst size, each
+ * telegram sent takes one telegram worth of tokens from the global bucket and
+ * from the bucket of its group address.
+ */
+class KnxTxLimiter {
+    KnxTokenBucket _global;
+    KnxTokenBucket _ga[KNX_TX_LIMIT_GA_SIZE];
+    word _groupAddr[KNX_TX_LIMIT_GA_SIZE];
+    byte _gaCount;
+    unsigned long _lastTimeMillisec;
+
+  public:
+    KnxTxLimiter();
+
+    void setLimit(byte rate, byte burst);
+    boolean setLimit(word groupAddr, byte rate, byte burst);
+
+    void refill(unsigned long nowTime);
+    boolean isAllowed(void);
+    boolean isAllowed(word groupAddr);
+    void consume(word groupAddr);
+
+    word getThrottledCount(void) const;
+    word getThrottledCount(word groupAddr) const;
+
+  private:
+    KnxTokenBucket* findBucket(word groupAddr);
+    static void initBucket(KnxTokenBucket& bucket, byte rate, byte burst);
+    static void refillBucket(KnxTokenBucket& bucket, unsigned long elapsed);
+    static boolean checkBucket(KnxTokenBucket& bucket);
+};
+
+// ----- Definition of the INLINED functions :  ------------
+inline word KnxTxLimiter::getThrottledCount(void) const { return _global.throttledCount; }
+
+#endif // KNXTXLIMITER_H
@@ -0,0 +1,579 @@
+/*
+ *    KnxTxQueue.h
+ *
+ *    Written by Christian Poulter.
+ *
+ *    Copyright (C) 2023 Christian Poulter <devel(at)poulter.de>
+ *    All rights reserved. This file is now part of the Ardunio SimpleKnx Library.
+ *
+ *    The Ardunio SimpleKnx Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef KNXTXQUEUE_H
+#define KNXTXQUEUE_H
+
+#include "Arduino.h"
+#include "KnxTelegram.h"
+
+#define KNX_TX_QUEUE_LEVELS 4
+#define KNX_TX_QUEUE_NONE   255
+
+// Buckets of the group address index, a power of two
+#ifndef KNX_TX_QUEUE_INDEX_SIZE
+#define KNX_TX_QUEUE_INDEX_SIZE 16
+#endif
+
+// What to do with a telegram appended to a full queue
+enum KnxTxQueuePolicy {
+    KNX_TX_QUEUE_REJECT = 0,    // refuse the new telegram
+    KNX_TX_QUEUE_OVERWRITE = 1, // drop the oldest telegram of the same priority, refuse if there is none
+    KNX_TX_QUEUE_EVICT = 2      // drop the oldest telegram of the lowest priority below the new one, refuse if there is none
+};
+
+// Result of appending a telegram
+enum KnxTxQueueResult {
+    KNX_TX_QUEUE_APPENDED = 0,  // queued
+    KNX_TX_QUEUE_REPLACED = 1,  // queued, another telegram was dropped for it
+    KNX_TX_QUEUE_REJECTED = 2,  // not queued
+    KNX_TX_QUEUE_COALESCED = 3, // replaced the pending telegram for the same group address and command
+    KNX_TX_QUEUE_SUPPRESSED = 4,// not queued, the value is within the deadband of the last one sent
+    KNX_TX_QUEUE_DEFERRED = 5   // not queued yet, held back until the minimum interval is over
+};
+
+/*
+ * Transmission queue ordered by KNX priority
+ *
+ * All telegrams share one pool of slots. Each priority level links its slots
+ * in FIFO order, pop always serves the highest level in bus arbitration order:
+ * system, alarm, high, normal.
+ *
+ * Items are not kept as T but stored into a byte arena with only the bytes they
+ * need, most telegrams are far shorter than the largest one. The arena is kept
+ * without gaps, removing an item moves the ones behind it. The queue is full if
+ * either all size slots or all arenaSize bytes are used. T provides:
+ *
+ *   byte getStoredSize(void) const;                    // bytes written by store, and
+ *   static byte getStoredSize(const byte stored[]);    // the same from the stored bytes
+ *   void store(byte stored[]) const;
+ *   void load(const byte stored[]);
+ *   word getTargetAddress(void) const;                 // and the same fields from
+ *   static word getTargetAddress(const byte stored[]); // the stored bytes
+ *   KnxCommand getCommand(void) const;
+ *   static KnxCommand getCommand(const byte stored[]);
+ *   KnxPriority getPriority(void) const;
+ *   static KnxPriority getPriority(const byte stored[]);
+ *
+ * With coalescing enabled, a telegram for the same target address, command and
+ * priority as a pending one replaces that one in place, so only the newest value
+ * is sent. An index hashed by target address finds the pending telegram.
+ *
+ * Items appended by appendToBatch between beginBatch and commitBatch are staged
+ * apart from the levels, in room reserved by beginBatch. commitBatch links all of
+ * them behind the items of the batch level at once, or none of them if one was
+ * rejected. Once the first member is popped, pop returns the other members before
+ * anything else, so they are sent back to back.
+ */
+template<typename T, byte size, byte arenaSize>
+class KnxTxQueue {
+    static_assert(size < KNX_TX_QUEUE_NONE, "size must be below 255");
+    static_assert((KNX_TX_QUEUE_INDEX_SIZE & (KNX_TX_QUEUE_INDEX_SIZE - 1)) == 0, "KNX_TX_QUEUE_INDEX_SIZE must be a power of two");
+
+    byte _arena[arenaSize];             // stored items without gaps
+    byte _used;                         // bytes of the arena in use
+    byte _offset[size];                 // arena offset per slot, the length is read from the stored bytes
+    byte _next[size];                   // next slot of the same level or of the free list
+    byte _head[KNX_TX_QUEUE_LEVELS];    // oldest slot per level
+    byte _tail[KNX_TX_QUEUE_LEVELS];    // newest slot per level
+    byte _free;                         // first unused slot
+    byte _bucket[KNX_TX_QUEUE_INDEX_SIZE]; // first slot per target address hash
+    byte _bucketNext[size];             // next slot with the same hash
+    byte _continued[(size + 7) / 8];    // bit per slot, set if the slot follows a member of the same batch
+    byte _batchLevel;                   // level of the open batch, KNX_TX_QUEUE_NONE if none is open
+    byte _batchHead;                    // oldest staged slot
+    byte _batchTail;                    // newest staged slot
+    byte _batchCount;
+    byte _batchSize;                    // members the open batch has room for
+    byte _batchItemSize;                // bytes reserved per member
+    byte _running;                      // next member of the batch being popped, KNX_TX_QUEUE_NONE if none
+    boolean _batchFailed;
+    boolean _coalescing;
+    byte _itemCount;
+    byte _dropCount;                    // telegrams dropped or refused because the queue was full (saturates at 255)
+    KnxTxQueuePolicy _policy;
+
+public:
+
+    /**
+     * Constructor
+     */
+    KnxTxQueue() {
+        for (byte i = 0; i < size; i++) _next[i] = i + 1;
+        _next[size - 1] = KNX_TX_QUEUE_NONE;
+        memset(_head, KNX_TX_QUEUE_NONE, sizeof(_head));
+        memset(_tail, KNX_TX_QUEUE_NONE, sizeof(_tail));
+        memset(_bucket, KNX_TX_QUEUE_NONE, sizeof(_bucket));
+        memset(_continued, 0, sizeof(_continued));
+        _batchLevel = KNX_TX_QUEUE_NONE;
+        _running = KNX_TX_QUEUE_NONE;
+        _free = 0;
+        _used = 0;
+        _coalescing = false;
+        _itemCount = 0;
+        _dropCount = 0;
+        _policy = KNX_TX_QUEUE_EVICT;
+    };
+
+    /**
+     * Sets what happens when appending to a full queue
+     * @param policy
+     */
+    void setPolicy(KnxTxQueuePolicy policy) {
+        _policy = policy;
+    }
+
+    /**
+     * Enables replacing pending telegrams by newer ones for the same target
+     * @param coalescing
+     */
+    void setCoalescing(boolean coalescing) {
+        _coalescing = coalescing;
+    }
+
+    /**
+     * Append data behind the items of the same priority. The room reserved for an open batch is not used.
+     * @param data
+     * @param dropped if not NULL, receives the item dropped or replaced for data
+     * @return if and how the data was queued
+     */
+    KnxTxQueueResult append(const T& data, T *dropped = NULL) {
+        KnxTxQueueResult result = KNX_TX_QUEUE_APPENDED;
+        byte level = getLevel(data.getPriority());
+        byte hash = getHash(data.getTargetAddress());
+        byte length = data.getStoredSize();
+
+        if (_coalescing) {
+            for (byte slot = _bucket[hash]; slot != KNX_TX_QUEUE_NONE; slot = _bucketNext[slot]) {
+                const byte *stored = &_arena[_offset[slot]];
+
+                if ((T::getTargetAddress(stored) == data.getTargetAddress()) &&
+                    (T::getCommand(stored) == data.getCommand()) &&
+                    (T::getPriority(stored) == data.getPriority())) {
+                    byte storedLength = T::getStoredSize(stored);
+
+                    // a longer telegram not fitting in is queued as a new one
+                    if (!fits(length, storedLength)) break;
+
+                    if (dropped != NULL) dropped->load(stored);
+
+                    if (storedLength != length) {
+                        freeBytes(slot);
+                        _offset[slot] = _used;
+                        _used += length;
+                    }
+                    data.store(&_arena[_offset[slot]]);
+
+                    return KNX_TX_QUEUE_COALESCED;
+                }
+            }
+        }
+
+        if ((_itemCount + _batchCount + getReservedSlots() >= size) || !fits(length, 0)) {
+            if (_dropCount < 255) _dropCount++;
+
+            if (!dropForLevel(level, length, dropped)) return KNX_TX_QUEUE_REJECTED;
+            result = KNX_TX_QUEUE_REPLACED;
+        }
+
+        byte slot = allocSlot(data, length);
+        setContinued(slot, false);
+
+        if (_tail[level] == KNX_TX_QUEUE_NONE) {
+            _head[level] = slot;
+        } else {
+            _next[_tail[level]] = slot;
+        }
+        _tail[level] = slot;
+        _itemCount++;
+
+        _bucketNext[slot] = _bucket[hash];
+        _bucket[hash] = slot;
+
+        return result;
+    }
+
+    /**
+     * Opens a batch and reserves room for its members, they are appended with appendToBatch
+     * @param count number of items the batch will hold at most
+     * @param itemSize stored bytes of the largest item
+     * @param priority level all members are queued at
+     * @return false, if a batch is already open or there is no room for count items of itemSize
+     */
+    boolean beginBatch(byte count, byte itemSize, KnxPriority priority) {
+        if ((_batchLevel != KNX_TX_QUEUE_NONE) || (_itemCount + count > size) ||
+            (_used + word(count) * itemSize > arenaSize)) return false;
+
+        _batchLevel = getLevel(priority);
+        _batchHead = KNX_TX_QUEUE_NONE;
+        _batchTail = KNX_TX_QUEUE_NONE;
+        _batchCount = 0;
+        _batchSize = count;
+        _batchItemSize = itemSize;
+        _batchFailed = false;
+
+        return true;
+    }
+
+    /**
+     * Stages data in the open batch. Neither replaces nor drops anything, the batch fails instead
+     * if it is not open, holds count items already or data is larger than itemSize.
+     * @param data
+     * @return KNX_TX_QUEUE_APPENDED or KNX_TX_QUEUE_REJECTED
+     */
+    KnxTxQueueResult appendToBatch(const T& data) {
+        byte length = data.getStoredSize();
+
+        if ((_batchLevel == KNX_TX_QUEUE_NONE) || _batchFailed || (_batchCount == _batchSize) || (length > _batchItemSize)) {
+            failBatch();
+            return KNX_TX_QUEUE_REJECTED;
+        }
+
+        byte slot = allocSlot(data, length);
+        setContinued(slot, _batchHead != KNX_TX_QUEUE_NONE);
+
+        if (_batchTail == KNX_TX_QUEUE_NONE) {
+            _batchHead = slot;
+        } else {
+            _next[_batchTail] = slot;
+        }
+        _batchTail = slot;
+        _batchCount++;
+
+        return KNX_TX_QUEUE_APPENDED;
+    }
+
+    /**
+     * Makes the open batch fail, commitBatch will refuse it
+     */
+    void failBatch(void) {
+        if (_batchLevel != KNX_TX_QUEUE_NONE) _batchFailed = true;
+    }
+
+    /**
+     * Returns true if a batch is open
+     */
+    boolean isBatchOpen(void) const {
+        return _batchLevel != KNX_TX_QUEUE_NONE;
+    }
+
+    /**
+     * Returns true if members of a batch are left to be popped after the first one
+     */
+    boolean isBatchRunning(void) const {
+        return _running != KNX_TX_QUEUE_NONE;
+    }
+
+    /**
+     * Queues all staged items behind the items of the batch level and closes the batch
+     * @return false, if no batch is open or a member was rejected. The batch stays
+     *         open then, popBatch takes its members back.
+     */
+    boolean commitBatch(void) {
+        if ((_batchLevel == KNX_TX_QUEUE_NONE) || _batchFailed) return false;
+
+        if (_batchHead != KNX_TX_QUEUE_NONE) {
+            for (byte slot = _batchHead; slot != KNX_TX_QUEUE_NONE; slot = _next[slot]) {
+                byte hash = getHash(T::getTargetAddress(&_arena[_offset[slot]]));
+                _bucketNext[slot] = _bucket[hash];
+                _bucket[hash] = slot;
+            }
+
+            if (_tail[_batchLevel] == KNX_TX_QUEUE_NONE) {
+                _head[_batchLevel] = _batchHead;
+            } else {
+                _next[_tail[_batchLevel]] = _batchHead;
+            }
+            _tail[_batchLevel] = _batchTail;
+            _itemCount += _batchCount;
+        }
+
+        _batchLevel = KNX_TX_QUEUE_NONE;
+        _batchCount = 0;
+        return true;
+    }
+
+    /**
+     * Takes back the oldest staged item of the open batch, closes the batch once empty
+     * @param data the staged data
+     * @return false, if no batch is open or no staged items are left
+     */
+    boolean popBatch(T& data) {
+        if (_batchLevel == KNX_TX_QUEUE_NONE) return false;
+
+        byte slot = _batchHead;
+        if (slot == KNX_TX_QUEUE_NONE) {
+            _batchLevel = KNX_TX_QUEUE_NONE;
+            return false;
+        }
+
+        data.load(&_arena[_offset[slot]]);
+        _batchHead = _next[slot];
+        if (_batchHead == KNX_TX_QUEUE_NONE) _batchTail = KNX_TX_QUEUE_NONE;
+        _batchCount--;
+
+        freeBytes(slot);
+        _next[slot] = _free;
+        _free = slot;
+
+        return true;
+    }
+
+    /**
+     * Pop the next member of the batch being popped, otherwise the oldest data of the highest priority
+     * @param data the popped data
+     * @return false, if no items available
+     */
+    boolean pop(T& data) {
+        if (_running != KNX_TX_QUEUE_NONE) {
+            popRunning(data);
+            return true;
+        }
+
+        for (byte level = 0; level < KNX_TX_QUEUE_LEVELS; level++) {
+            if (_head[level] != KNX_TX_QUEUE_NONE) {
+                data.load(&_arena[_offset[_head[level]]]);
+                removeSlot(level, KNX_TX_QUEUE_NONE);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Pop the oldest data of the highest priority the limiter allows, skipping the others.
+     * A batch is started only if the limiter allows all of its members. Once started,
+     * nothing but its next member is popped, also if the limiter holds that one back.
+     * @param data the popped data
+     * @param limiter anything with isAllowed(word targetAddress)
+     * @return false, if no allowed items available
+     */
+    template<typename L>
+    boolean pop(T& data, L& limiter) {
+        if (_running != KNX_TX_QUEUE_NONE) {
+            if (!limiter.isAllowed(T::getTargetAddress(&_arena[_offset[_running]]))) return false;
+
+            popRunning(data);
+            return true;
+        }
+
+        for (byte level = 0; level < KNX_TX_QUEUE_LEVELS; level++) {
+            byte prev = KNX_TX_QUEUE_NONE;
+
+            for (byte slot = _head[level]; slot != KNX_TX_QUEUE_NONE; prev = slot, slot = _next[slot]) {
+                if (isContinued(slot)) continue;
+
+                if (isAllowed(slot, limiter)) {
+                    data.load(&_arena[_offset[slot]]);
+                    removeSlot(level, prev);
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Returns number of items in buffer
+     * @return item count
+     */
+    byte getItemCount(void) const {
+        return _itemCount;
+    }
+
+    /**
+     * Returns number of items dropped or refused because the queue was full (saturates at 255)
+     */
+    byte getDropCount(void) const {
+        return _dropCount;
+    }
+
+private:
+
+    // level 0 is sent first, the priority bits are sent LSB first and a 0 wins the arbitration
+    static byte getLevel(KnxPriority priority) {
+        switch (priority) {
+            case KNX_PRIORITY_SYSTEM_VALUE: return 0;
+            case KNX_PRIORITY_ALARM_VALUE:  return 1;
+            case KNX_PRIORITY_HIGH_VALUE:   return 2;
+            default:                        return 3;
+        }
+    }
+
+    static byte getHash(word addr) {
+        return (byte(addr) ^ byte(addr >> 8)) & (KNX_TX_QUEUE_INDEX_SIZE - 1);
+    }
+
+    // makes room for an item of level and length following the policy, dropping one item at most.
+    // Members of committed batches are not dropped, a batch is sent complete or not at all.
+    // Returns false if nothing was dropped.
+    boolean dropForLevel(byte level, byte length, T *dropped) {
+        byte from, to;
+
+        switch (_policy) {
+            case KNX_TX_QUEUE_OVERWRITE:
+                from = level;
+                to = level;
+                break;
+
+            case KNX_TX_QUEUE_EVICT:
+                if (level == KNX_TX_QUEUE_LEVELS - 1) return false;
+                from = KNX_TX_QUEUE_LEVELS - 1;
+                to = level + 1;
+                break;
+
+            default:
+                return false;
+        }
+
+        // the oldest item of the lowest level in range
+        for (byte victim = from + 1; victim-- > to; ) {
+            byte prev = KNX_TX_QUEUE_NONE;
+
+            for (byte slot = _head[victim]; slot != KNX_TX_QUEUE_NONE; prev = slot, slot = _next[slot]) {
+                if (isBatchMember(slot)) continue;
+
+                if (!fits(length, T::getStoredSize(&_arena[_offset[slot]]))) return false;
+
+                if (dropped != NULL) dropped->load(&_arena[_offset[slot]]);
+                removeSlot(victim, prev);
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // slots kept free for the members still to come of the open batch
+    byte getReservedSlots(void) const {
+        return (_batchLevel == KNX_TX_QUEUE_NONE) ? 0 : _batchSize - _batchCount;
+    }
+
+    // true if length bytes fit in once freed bytes are free, besides the bytes reserved for the open batch
+    boolean fits(byte length, byte freed) const {
+        return _used - freed + length + word(getReservedSlots()) * _batchItemSize <= arenaSize;
+    }
+
+    // true if the limiter allows slot and the members of the batch following it
+    template<typename L>
+    boolean isAllowed(byte slot, L& limiter) const {
+        do {
+            if (!limiter.isAllowed(T::getTargetAddress(&_arena[_offset[slot]]))) return false;
+            slot = _next[slot];
+        } while ((slot != KNX_TX_QUEUE_NONE) && isContinued(slot));
+
+        return true;
+    }
+
+    // pops the next member of the batch being popped, wherever it is in its level
+    void popRunning(T& data) {
+        byte slot = _running;
+        byte level = getLevel(T::getPriority(&_arena[_offset[slot]]));
+        byte prev = KNX_TX_QUEUE_NONE;
+
+        for (byte i = _head[level]; i != slot; i = _next[i]) prev = i;
+
+        data.load(&_arena[_offset[slot]]);
+        removeSlot(level, prev);
+    }
+
+    // takes a free slot and stores data of length behind the used bytes
+    byte allocSlot(const T& data, byte length) {
+        byte slot = _free;
+        _free = _next[slot];
+
+        _offset[slot] = _used;
+        data.store(&_arena[_used]);
+        _used += length;
+        _next[slot] = KNX_TX_QUEUE_NONE;
+
+        return slot;
+    }
+
+    // true if slot belongs to a committed batch, the first member and the next one of a running batch included
+    boolean isBatchMember(byte slot) const {
+        return isContinued(slot) || (slot == _running) || ((_next[slot] != KNX_TX_QUEUE_NONE) && isContinued(_next[slot]));
+    }
+
+    boolean isContinued(byte slot) const {
+        return _continued[slot >> 3] & (1 << (slot & 7));
+    }
+
+    void setContinued(byte slot, boolean continued) {
+        if (continued) {
+            _continued[slot >> 3] |= (1 << (slot & 7));
+        } else {
+            _continued[slot >> 3] &= ~(1 << (slot & 7));
+        }
+    }
+
+    // closes the gap of the bytes of slot in the arena
+    void freeBytes(byte slot) {
+        byte offset = _offset[slot];
+        byte length = T::getStoredSize(&_arena[offset]);
+
+        memmove(&_arena[offset], &_arena[offset + length], _used - offset - length);
+        _used -= length;
+
+        // offsets of unused slots are rewritten when they are used again
+        for (byte i = 0; i < size; i++) {
+            if (_offset[i] > offset) _offset[i] -= length;
+        }
+    }
+
+    // removes the slot behind prev from level, the head if prev is KNX_TX_QUEUE_NONE
+    void removeSlot(byte level, byte prev) {
+        byte slot = (prev == KNX_TX_QUEUE_NONE) ? _head[level] : _next[prev];
+        byte *link = &_bucket[getHash(T::getTargetAddress(&_arena[_offset[slot]]))];
+
+        while (*link != slot) link = &_bucketNext[*link];
+        *link = _bucketNext[slot];
+
+        // the next member of the same batch becomes its first one, and is popped next.
+        // Only pop removes batch members, dropForLevel skips them.
+        if ((_next[slot] != KNX_TX_QUEUE_NONE) && isContinued(_next[slot])) {
+            setContinued(_next[slot], false);
+            if ((_running == KNX_TX_QUEUE_NONE) || (_running == slot)) _running = _next[slot];
+        } else if (_running == slot) {
+            _running = KNX_TX_QUEUE_NONE;
+        }
+
+        if (prev == KNX_TX_QUEUE_NONE) {
+            _head[level] = _next[slot];
+        } else {
+            _next[prev] = _next[slot];
+        }
+        if (_tail[level] == slot) _tail[level] = prev;
+
+        freeBytes(slot);
+
+        _next[slot] = _free;
+        _free = slot;
+        _itemCount--;
+    }
+};
+
+#endif // KNXTXQUEUE_H
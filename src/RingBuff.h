@@ -20,13 +20,27 @@
 
 #include "Arduino.h"
 
+// Index type of RingBuff, a byte up to 255 items
+template<bool small> struct RingBuffIndex { typedef byte type; };
+template<> struct RingBuffIndex<false> { typedef word type; };
+
+/*
+ * Ring buffer, appending to a full buffer overwrites the oldest item.
+ *
+ * Besides copying items in and out, an item can be filled in place: reserve returns
+ * the free tail slot and commit appends it. Likewise peek returns the head item and
+ * drop removes it once it is handled. Power of two sizes wrap the indices with a mask.
+ */
 template<typename T, uint16_t size>
 class RingBuff {
-    byte _head;
-    byte _tail;
+    static_assert(size > 0, "size must not be 0");
+
+    typedef typename RingBuffIndex<(size <= 255)>::type index_t;
+
+    index_t _head;
+    index_t _tail;
+    index_t _itemCount;
     T _buffer[size]; // item buffer
-    byte _size;
-    byte _itemCount;
 
 public:
 
@@ -34,25 +48,45 @@ public:
      * Constructor
      */
     RingBuff() {
-        _head = 0;
-        _tail = 0;
-        _itemCount = 0;
-        _size = size;
+        clear();
     };
 
-
     /**
      * Append data to tail
      * @param appendedData
      */
     void append(const T& data) {
-        if (_itemCount == _size) { // buffer full, overwriting oldest data
-            incHead();
+        _buffer[_tail] = data;
+        commit();
+    }
+
+    /**
+     * Append count items to tail, overwriting the oldest ones if needed
+     * @param data
+     * @param count
+     */
+    void append(const T data[], index_t count) {
+        for (index_t i = 0; i < count; i++) append(data[i]);
+    }
+
+    /**
+     * Returns the tail slot to be filled in place, followed by commit
+     * @return NULL, if the buffer is full
+     */
+    T* reserve(void) {
+        return (_itemCount == size) ? NULL : &_buffer[_tail];
+    }
+
+    /**
+     * Appends the tail slot, overwriting the oldest item if the buffer is full
+     */
+    void commit(void) {
+        if (_itemCount == size) { // buffer full, overwriting oldest data
+            _head = next(_head);
         } else {
             _itemCount++;
         }
-        _buffer[_tail] = data;
-        incTail();
+        _tail = next(_tail);
     }
 
     /**
@@ -63,27 +97,66 @@ public:
     boolean pop(T& data) {
         if (_itemCount==0) return false;
         data = _buffer[_head];
-        incHead();
-        _itemCount--;
+        drop();
         return true;
     }
 
+    /**
+     * Pop up to count items from head
+     * @param data the popped data
+     * @param count
+     * @return number of popped items
+     */
+    index_t pop(T data[], index_t count) {
+        index_t popped = 0;
+        while ((popped < count) && pop(data[popped])) popped++;
+        return popped;
+    }
+
+    /**
+     * Returns the head item in place, followed by drop once it is handled
+     * @return NULL, if no items available
+     */
+    T* peek(void) {
+        return (_itemCount == 0) ? NULL : &_buffer[_head];
+    }
+
+    const T* peek(void) const {
+        return (_itemCount == 0) ? NULL : &_buffer[_head];
+    }
+
+    /**
+     * Removes the head item, if there is one
+     */
+    void drop(void) {
+        if (_itemCount == 0) return;
+        _head = next(_head);
+        _itemCount--;
+    }
+
+    /**
+     * Removes all items
+     */
+    void clear(void) {
+        _head = 0;
+        _tail = 0;
+        _itemCount = 0;
+    }
+
     /**
      * Returns number of items in buffer
      * @return item count
      */
-    byte getItemCount(void) const {
+    index_t getItemCount(void) const {
         return _itemCount;
     }
 
 private:
 
-    void incHead(void) {
-        _head = (_head + 1) % _size;
-    }
-
-    void incTail(void) {
-        _tail = (_tail + 1) % _size;
+    // the condition is constant, only one branch is compiled in
+    static index_t next(index_t index) {
+        if ((size & (size - 1)) == 0) return (index + 1) & (size - 1);
+        return (index + 1 == size) ? 0 : index + 1;
     }
 };
 
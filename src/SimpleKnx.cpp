@@ -46,12 +46,74 @@
 
 SimpleKnx_ &SimpleKnx = SimpleKnx.getInstance();
 
+// Compatibility shim for sketches still implementing telegramEventCallback,
+// replaced by the sketch's own telegramReceivedCallback if there is one
+void telegramReceivedCallback(const KnxTelegram& telegram) __attribute__((weak));
+void telegramReceivedCallback(const KnxTelegram& telegram) {
+    if (telegramEventCallback) {
+        telegramEventCallback(telegram);
+    }
+}
+
+// layout: command high bits, priority and payload length, target address, low command field
+// and payload, handle, enqueue time
+void KnxTxEntry::store(byte stored[]) const {
+    byte length = telegram.getTelegramLength() - 1;
+    word enqueueTime = word(enqueueTimeMicrosec >> KNX_TX_ENTRY_TIME_SHIFT);
+    byte i = 0;
+
+    stored[i++] = ((telegram.getRawByte(6) & COMMAND_FIELD_HIGH_COMMAND_MASK) << 6) +
+                  ((telegram.getPriority() & CONTROL_FIELD_PRIORITY_MASK) << 2) + telegram.getPayloadLength();
+    stored[i++] = telegram.getRawByte(3);
+    stored[i++] = telegram.getRawByte(4);
+    for (byte j = 7; j < length; j++) stored[i++] = telegram.getRawByte(j);
+
+    stored[i++] = handle;
+    stored[i++] = byte(enqueueTime >> 8);
+    stored[i] = byte(enqueueTime);
+}
+
+void KnxTxEntry::load(const byte stored[]) {
+    byte length = getStoredSize(stored) - 3;
+    unsigned long now = micros() >> KNX_TX_ENTRY_TIME_SHIFT;
+    word enqueueTime;
+    byte i = 3;
+
+    telegram.clearTelegram();
+    telegram.setPriority(getPriority(stored));
+    telegram.setRawByte(stored[1], 3);
+    telegram.setRawByte(stored[2], 4);
+    telegram.setRawByte((ROUTING_FIELD_DEFAULT_VALUE & ~ROUTING_FIELD_PAYLOAD_LENGTH_MASK) + (stored[0] & ROUTING_FIELD_PAYLOAD_LENGTH_MASK), 5);
+    telegram.setRawByte(stored[0] >> 6, 6);
+    for (byte j = 7; i < length; j++) telegram.setRawByte(stored[i++], j);
+    telegram.updateChecksum();
+
+    handle = stored[i];
+    enqueueTime = (word(stored[i + 1]) << 8) + stored[i + 2];
+
+    // only the low bits of the time are stored, the upper ones are taken from now
+    enqueueTimeMicrosec = (now - word(word(now) - enqueueTime)) << KNX_TX_ENTRY_TIME_SHIFT;
+}
+
 SimpleKnx_::SimpleKnx_() {
     _tpuart = NULL;
+    _txExtTelegram = NULL;
+    _txExtPending = false;
+    _txEntryIndex = 0;
+    _txEntry[0].handle = KNX_TX_HANDLE_NONE;
+    _txEntry[1].handle = KNX_TX_HANDLE_NONE;
+    _txExtHandle = KNX_TX_HANDLE_NONE;
+    _txLastHandle = KNX_TX_HANDLE_NONE;
+    _txNextHandle = KNX_TX_HANDLE_NONE;
+    _txBatchPriority = KNX_PRIORITY_NORMAL_VALUE;
+    _txInTask = false;
+    _txRetries = KNX_TX_RETRIES;
+    _txFailedCount = 0;
 }
 
 void SimpleKnx_::init(HardwareSerial &serial, word deviceAddress) {
     _deviceAddress = deviceAddress;
+    _cyclic.setSeed(deviceAddress ^ word(micros()));
     
     KnxDeviceStatus status = begin(serial);
 
@@ -71,15 +133,16 @@ void SimpleKnx_::reboot() {
 }
 
 KnxDeviceStatus SimpleKnx_::begin(HardwareSerial& serial) {
-    delete _tpuart;
+    KnxTpUart *tpuart = _tpuart;
+    _tpuart = NULL;
+    delete tpuart;
+
     _tpuart = new KnxTpUart(serial, _deviceAddress, _groupAddressList, _groupAddressListSize);
     
-    _rxTelegram = &_tpuart->getReceivedTelegram();
     if (_tpuart->reset() != KNX_TPUART_OK) {
         delete (_tpuart);
         
         _tpuart = NULL;
-        _rxTelegram = NULL;
         
         return KNX_DEVICE_INIT_ERROR;
     }
@@ -95,14 +158,15 @@ KnxDeviceStatus SimpleKnx_::begin(HardwareSerial& serial) {
 
 // Stop the KNX Device
 void SimpleKnx_::end() {
-    while ( _txActionList.getItemCount() > 0 ) {
+    // nothing is sent in bus monitor mode
+    while ( (_tpuart != NULL) && !_tpuart->isBusmonActive() && ((_txActionList.getItemCount() > 0) || _txExtPending) ) {
         task();
     }
     
-    _rxTelegram = NULL;
-
-    delete (_tpuart);
+    // unhook before deleting, rxIsr might fire in between
+    KnxTpUart *tpuart = _tpuart;
     _tpuart = NULL;
+    delete (tpuart);
 }
 
 SimpleKnx_ &SimpleKnx_::getInstance() {
@@ -115,22 +179,36 @@ void SimpleKnx_::getTpUartEvents(KnxTpUartEvent event) {
 
     switch (event) {
       
-        // Manage RECEIVED MESSAGES
-        case TPUART_EVENT_RECEIVED_KNX_TELEGRAM: {
-            KnxTelegram telegram = SimpleKnx._tpuart->getReceivedTelegram();
-            telegramEventCallback(telegram);
-
-        } break;
-        
         // Manage RESET events
         case TPUART_EVENT_RESET: {
             
+            // telegrams handed to the TPUART are lost
+            SimpleKnx.txSentCompleted(KNX_TX_FAILED);
+            for (byte i = 0; i < 2; i++) {
+                KnxTxEntry &entry = SimpleKnx._txEntry[i];
+                SimpleKnx.txCompleted(entry.handle, entry.getTargetAddress(), entry.enqueueTimeMicrosec, false, KNX_TX_FAILED);
+            }
+
             // wait for successfull reset
             while (SimpleKnx._tpuart->reset() == KNX_TPUART_ERROR) {}
                 
             SimpleKnx._tpuart->init();
         } break;
         
+        case TPUART_EVENT_KNX_TELEGRAM_SEND_FAILED: {
+            if (SimpleKnx._txFailedCount < 255) SimpleKnx._txFailedCount++;
+
+            if (telegramSendFailedCallback) {
+                telegramSendFailedCallback(SimpleKnx._tpuart->getSentTargetAddress());
+            }
+
+            SimpleKnx.txSentCompleted(KNX_TX_FAILED);
+        } break;
+
+        case TPUART_EVENT_KNX_TELEGRAM_SENT: {
+            SimpleKnx.txSentCompleted(KNX_TX_CONFIRMED);
+        } break;
+
         // noop
         default: {}
         
@@ -139,8 +217,11 @@ void SimpleKnx_::getTpUartEvents(KnxTpUartEvent event) {
 
 void SimpleKnx_::task(void) {
 
+    _txInTask = true;
+
     do {
         word nowTimeMicros = micros();
+        boolean freeToSend;
         
         DEBUG5_PRINTLN(F("SimpleKnx task %lu"), nowTimeMicros);
         
@@ -149,14 +230,43 @@ void SimpleKnx_::task(void) {
             _lastRXTimeMicros = nowTimeMicros;
             _tpuart->rxTask();
 
+            // txTask does not block, so a telegram being sent keeps streaming meanwhile
             while ( _tpuart->isRxActive() ) {
                 _tpuart->rxTask();
+                _tpuart->txTask();
             }
         }
 
-        // STEP 2: Send KNX messages following TX actions
-        if (_tpuart->isFreeToSend() && _txActionList.pop(_txTelegram)) {
-            _tpuart->sendTelegram(_txTelegram);
+        // STEP 2: Send KNX messages following TX actions. While a telegram is on the bus, the next
+        // one is handed over already, so it goes out as soon as the current one is confirmed.
+        // Extended telegrams are only sent on a free bus, nothing is prepared while one waits.
+        freeToSend = _tpuart->isFreeToSend();
+        if ((freeToSend || (_tpuart->isReadyForNext() && !_txExtPending)) &&
+            (_txExtPending || (_txActionList.getItemCount() > 0))) {
+            _txLimiter.refill(millis());
+
+            if (!_txLimiter.isAllowed()) {
+                // wait for the global bucket, everything stays queued
+
+            } else if (freeToSend && _txExtPending && !_txActionList.isBatchRunning() &&
+                       _txLimiter.isAllowed(_txExtTelegram->getTargetAddress())) {
+                // the slot stays in use until the TPUART is done with it, see isSending
+                _txExtPending = false;
+                _txLimiter.consume(_txExtTelegram->getTargetAddress());
+                _tpuart->sendTelegram(*_txExtTelegram, _txRetries);
+
+            } else if (_txActionList.pop(_txEntry[_txEntryIndex], _txLimiter)) {
+                _txLimiter.consume(_txEntry[_txEntryIndex].getTargetAddress());
+
+                if (freeToSend) {
+                    _tpuart->sendTelegram(_txEntry[_txEntryIndex].telegram, _txRetries);
+                } else {
+                    _tpuart->sendNextTelegram(_txEntry[_txEntryIndex].telegram, _txRetries);
+                }
+
+                // the other buffer is free once the TPUART moved on to this one
+                _txEntryIndex ^= 1;
+            }
         }
 
         // STEP 3: LET THE TP-UART TRANSMIT KNX MESSAGES
@@ -167,86 +277,370 @@ void SimpleKnx_::task(void) {
         }
         
     } while (_tpuart->isActive());
+
+    // STEP 4: hand one received telegram to the application, outside of the byte level loop.
+    // The telegram is passed in place and released after the callback.
+    const KnxTelegram *rxTelegram = _tpuart->peekReceivedTelegram();
+    if (rxTelegram != NULL) {
+        telegramReceivedCallback(*rxTelegram);
+        _tpuart->popReceivedTelegram();
+    }
+
+    const KnxExtTelegram *rxExtTelegram = _tpuart->peekReceivedExtTelegram();
+    if (rxExtTelegram != NULL) {
+        if (extTelegramReceivedCallback) {
+            extTelegramReceivedCallback(*rxExtTelegram);
+        }
+        _tpuart->popReceivedExtTelegram();
+    }
+
+    // STEP 5: let the application queue the cyclic values due, they are sent with the next task
+    _cyclic.advance(millis(), cyclicSendCallback);
+
+    // STEP 6: queue a value held back by send on change, or repeat one after the maximum silence
+    word changeGroupAddress;
+    float changeValue;
+    byte changeTag;
+    if (_changeFilter.pop(millis(), changeGroupAddress, changeValue, changeTag)) {
+        writeFloatValue(changeTag, changeGroupAddress, changeValue, false);
+    }
+
+    _txInTask = false;
 }
 
-void SimpleKnx_::appendTelegram(bool answer, word groupAddress, byte data[], byte length) {
-    KnxTelegram txTelegram;
-    txTelegram.setTargetAddress(groupAddress);
-    txTelegram.setCommand(answer ? KNX_COMMAND_VALUE_RESPONSE : KNX_COMMAND_VALUE_WRITE);
-    txTelegram.setPayload(data, length);
+// see KnxTpUart::activateBusmon
+byte SimpleKnx_::startBusmon(void) {
+    return (_tpuart != NULL) ? _tpuart->activateBusmon() : KNX_TPUART_ERROR;
+}
 
-    DEBUG2_PRINTLN(F("appendTelegram ga=0x%04x length=%d data=0x%02x"), txTelegram.getTargetAddress(), length, data[0]);
+// writes the oldest captured frame to buffer, returns its length or 0 if there is none
+// see KnxTpUart.h for the frame format
+byte SimpleKnx_::readBusmonFrame(byte buffer[], byte bufferSize) {
+    return (_tpuart != NULL) ? _tpuart->readBusmonFrame(buffer, bufferSize) : 0;
+}
+
+void SimpleKnx_::setRxEopGap(word gapMicrosec) {
+    if (_tpuart != NULL) {
+        _tpuart->setRxEopGap(gapMicrosec);
+    }
+}
 
-    _txActionList.append(txTelegram);
+void SimpleKnx_::setTxQueuePolicy(KnxTxQueuePolicy policy) {
+    _txActionList.setPolicy(policy);
 }
 
-void SimpleKnx_::groupWriteBool(bool answer, word groupAddress, bool value) {
+void SimpleKnx_::setTxCoalescing(boolean coalescing) {
+    _txActionList.setCoalescing(coalescing);
+}
+
+byte SimpleKnx_::getTxQueueDropCount(void) const {
+    return _txActionList.getDropCount();
+}
+
+void SimpleKnx_::setTxRetries(byte retries) {
+    _txRetries = retries;
+}
+
+byte SimpleKnx_::getTxFailedCount(void) const {
+    return _txFailedCount;
+}
+
+void SimpleKnx_::setTxRateLimit(byte rate, byte burst) {
+    _txLimiter.setLimit(rate, burst);
+}
+
+// returns false if KNX_TX_LIMIT_GA_SIZE group addresses are limited already
+boolean SimpleKnx_::setTxRateLimit(word groupAddress, byte rate, byte burst) {
+    return _txLimiter.setLimit(groupAddress, rate, burst);
+}
+
+word SimpleKnx_::getTxThrottledCount(void) const {
+    return _txLimiter.getThrottledCount();
+}
+
+word SimpleKnx_::getTxThrottledCount(word groupAddress) const {
+    return _txLimiter.getThrottledCount(groupAddress);
+}
+
+byte SimpleKnx_::getRxQueueMaxCount(void) const {
+    return (_tpuart != NULL) ? _tpuart->getRxQueueMaxCount() : 0;
+}
+
+byte SimpleKnx_::getRxQueueOverflowCount(void) const {
+    return (_tpuart != NULL) ? _tpuart->getRxQueueOverflowCount() : 0;
+}
+
+byte SimpleKnx_::getRxDuplicateCount(void) const {
+    return (_tpuart != NULL) ? _tpuart->getRxDuplicateCount() : 0;
+}
+
+// see KnxTimerWheel::setTimer
+boolean SimpleKnx_::setCyclicSend(word groupAddress, unsigned long periodMillisec) {
+    return _cyclic.setTimer(groupAddress, periodMillisec);
+}
+
+// see KnxChangeFilter::setFilter
+boolean SimpleKnx_::setSendOnChange(word groupAddress, float deadband, boolean relative, word minIntervalMillisec, word maxSilenceSec) {
+    return _changeFilter.setFilter(groupAddress, deadband, relative, minIntervalMillisec, maxSilenceSec);
+}
+
+KnxTxHandle SimpleKnx_::getLastTxHandle(void) const {
+    return _txLastHandle;
+}
+
+#ifdef KNX_RX_ISR
+// call from the UART RX or a timer interrupt, see KnxTpUart::rxIsr
+void SimpleKnx_::rxIsr(void) {
+    if (_tpuart != NULL) {
+        _tpuart->rxIsr();
+    }
+}
+#endif
+
+KnxTxHandle SimpleKnx_::newTxHandle(void) {
+    if (++_txNextHandle == KNX_TX_HANDLE_NONE) _txNextHandle++;
+    return _txNextHandle;
+}
+
+// reports the completion of the telegram with handle and clears the handle, nothing if it is cleared already
+void SimpleKnx_::txCompleted(KnxTxHandle& handle, word groupAddress, unsigned long enqueueTime, boolean started, KnxTxStatus status) {
+    if (handle == KNX_TX_HANDLE_NONE) return;
+
+    DEBUG2_PRINTLN(F("txCompleted handle=%u ga=0x%04x status=%d"), handle, groupAddress, status);
+
+    if (telegramCompletedCallback) {
+        KnxTxCompletion completion;
+        completion.handle = handle;
+        completion.groupAddress = groupAddress;
+        completion.status = status;
+        completion.enqueueTimeMicrosec = enqueueTime;
+        completion.doneTimeMicrosec = micros();
+        completion.startTimeMicrosec = started ? _tpuart->getSentStartTime() : completion.doneTimeMicrosec;
+
+        telegramCompletedCallback(completion);
+    }
+
+    handle = KNX_TX_HANDLE_NONE;
+}
+
+// reports the completion of the telegram the TPUART was sending
+void SimpleKnx_::txSentCompleted(KnxTxStatus status) {
+    const KnxTelegram *sentTelegram = _tpuart->getSentTelegram();
+
+    if (sentTelegram == NULL) {
+        // a pending extended telegram was not handed over yet
+        if ((_txExtHandle != KNX_TX_HANDLE_NONE) && !_txExtPending) {
+            txCompleted(_txExtHandle, _txExtTelegram->getTargetAddress(), _txExtEnqueueTimeMicrosec, true, status);
+        }
+        return;
+    }
+
+    for (byte i = 0; i < 2; i++) {
+        KnxTxEntry &entry = _txEntry[i];
+        if (sentTelegram == &entry.telegram) {
+            txCompleted(entry.handle, entry.getTargetAddress(), entry.enqueueTimeMicrosec, true, status);
+        }
+    }
+}
+
+boolean SimpleKnx_::beginTxBatch(byte count, KnxPriority priority, byte size) {
+    KnxTxEntry largest;
+    byte data[KNX_TELEGRAM_PAYLOAD_MAX_SIZE] = { 0 };
+
+    largest.telegram.setPayload(data, min(size, byte(KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 2)));
+    if (!_txActionList.beginBatch(count, largest.getStoredSize(), priority)) return false;
+
+    _txBatchPriority = priority;
+    return true;
+}
+
+boolean SimpleKnx_::commitTxBatch(void) {
+    if (_txActionList.commitBatch()) return true;
+
+    abortTxBatch();
+    return false;
+}
+
+void SimpleKnx_::abortTxBatch(void) {
+    KnxTxEntry txEntry;
+
+    while (_txActionList.popBatch(txEntry)) {
+        txCompleted(txEntry.handle, txEntry.getTargetAddress(), txEntry.enqueueTimeMicrosec, false, KNX_TX_DROPPED);
+    }
+}
+
+KnxTxQueueResult SimpleKnx_::appendTelegram(bool answer, word groupAddress, const byte data[], byte length, KnxPriority priority) {
+    KnxTxEntry txEntry;
+    KnxTxEntry dropped;
+    KnxTxQueueResult result;
+
+    // writes from within task, e.g. cyclic or send on change values, are not part of the batch
+    boolean batched = _txActionList.isBatchOpen() && !_txInTask;
+
+    if (batched) priority = _txBatchPriority;
+
+    txEntry.telegram.setPriority(priority);
+    txEntry.telegram.setTargetAddress(groupAddress);
+    txEntry.telegram.setCommand(answer ? KNX_COMMAND_VALUE_RESPONSE : KNX_COMMAND_VALUE_WRITE);
+    txEntry.telegram.setPayload(data, length);
+    txEntry.handle = newTxHandle();
+    txEntry.enqueueTimeMicrosec = micros();
+
+    DEBUG2_PRINTLN(F("appendTelegram ga=0x%04x length=%d data=0x%02x"), txEntry.getTargetAddress(), length, data[0]);
+
+    result = batched ? _txActionList.appendToBatch(txEntry) : _txActionList.append(txEntry, &dropped);
+    _txLastHandle = (result == KNX_TX_QUEUE_REJECTED) ? KNX_TX_HANDLE_NONE : txEntry.handle;
+
+    if ((result == KNX_TX_QUEUE_REPLACED) || (result == KNX_TX_QUEUE_COALESCED)) {
+        txCompleted(dropped.handle, dropped.getTargetAddress(), dropped.enqueueTimeMicrosec, false, KNX_TX_DROPPED);
+    }
+
+    return result;
+}
+
+KnxTxQueueResult SimpleKnx_::groupWriteBool(bool answer, word groupAddress, bool value, KnxPriority priority) {
     byte data[] = { byte(value ? B00000001 : B00000000) };
-    appendTelegram(answer, groupAddress, data, 0);
+    return appendTelegram(answer, groupAddress, data, 0, priority);
 }
 
-void SimpleKnx_::groupWrite2BitIntValue(bool answer, word groupAddress, byte value) {
+KnxTxQueueResult SimpleKnx_::groupWrite2BitIntValue(bool answer, word groupAddress, byte value, KnxPriority priority) {
     byte data[] = { byte(value & B00000011) };
-    appendTelegram(answer, groupAddress, data, 0);
+    return appendTelegram(answer, groupAddress, data, 0, priority);
 }
 
-void SimpleKnx_::groupWrite4BitIntValue(bool answer, word groupAddress, byte value) {
+KnxTxQueueResult SimpleKnx_::groupWrite4BitIntValue(bool answer, word groupAddress, byte value, KnxPriority priority) {
     byte data[] = { byte(value & B00001111) };
-    appendTelegram(answer, groupAddress, data, 0);
+    return appendTelegram(answer, groupAddress, data, 0, priority);
 }
 
-void SimpleKnx_::groupWrite1ByteIntValue(bool answer, word groupAddress, byte value) {
+KnxTxQueueResult SimpleKnx_::groupWrite1ByteIntValue(bool answer, word groupAddress, byte value, KnxPriority priority) {
     byte data[] = { value };
-    appendTelegram(answer, groupAddress, data, 1);
+    return appendTelegram(answer, groupAddress, data, 1, priority);
 }
 
-void SimpleKnx_::groupWrite2ByteIntValue(bool answer, word groupAddress, int value) {
+KnxTxQueueResult SimpleKnx_::groupWrite2ByteIntValue(bool answer, word groupAddress, int value, KnxPriority priority) {
     byte data[] = { byte(value >> 8), byte(value & 0xFF) };
-    appendTelegram(answer, groupAddress, data, 2);
+    return appendTelegram(answer, groupAddress, data, 2, priority);
 }
 
 
-void SimpleKnx_::groupWrite4ByteIntValue(bool answer, word groupAddress, long value) {
+KnxTxQueueResult SimpleKnx_::groupWrite4ByteIntValue(bool answer, word groupAddress, long value, KnxPriority priority) {
     byte data[] = { byte(value >> 24), byte(value >> 16), byte(value >> 8), byte(value & 0xFF) };
-    appendTelegram(answer, groupAddress, data, 4);
+    return appendTelegram(answer, groupAddress, data, 4, priority);
 }
 
-void SimpleKnx_::groupWrite2ByteFloatValue(bool answer, word groupAddress, float value) {
+// The float writes pass the send on change filter. The tag keeps how to write a value held
+// back: priority bits, answer and the float size, or hundredths of a 2 byte float.
+#define KNX_FLOAT_TAG_ANSWER 0x01
+#define KNX_FLOAT_TAG_4BYTE  0x02
+#define KNX_FLOAT_TAG_CENTI  0x10
+
+KnxTxQueueResult SimpleKnx_::groupWrite2ByteFixedValue(bool answer, word groupAddress, long centi, KnxPriority priority) {
     byte data[2];
-    
-    long longValuex100 = (long)(100.0 * value);
-    bool negativeSign = (longValuex100 & 0x80000000) ? true : false;
-    byte exponent = 0;
-    byte round = 0;
-
-    if (negativeSign) {
-        while (longValuex100 < (long)(-2048)) {
-            exponent++;
-            round = (byte)(longValuex100)&1;
-            longValuex100 >>= 1;
-            longValuex100 |= 0x80000000;
-        }
+
+    // the filter compares floats, so they are only used for group addresses sent on change
+    if (_changeFilter.isFiltered(groupAddress)) {
+        return writeFloatValue(priority | (answer ? KNX_FLOAT_TAG_ANSWER : 0) | KNX_FLOAT_TAG_CENTI, groupAddress, centi / 100.0, true);
+    }
+
+    KnxDptCodec<9>::encodeCenti(centi, data);
+    return appendTelegram(answer, groupAddress, data, 2, priority);
+}
+
+KnxTxQueueResult SimpleKnx_::groupWrite2ByteFloatValue(bool answer, word groupAddress, float value, KnxPriority priority) {
+    return writeFloatValue(priority | (answer ? KNX_FLOAT_TAG_ANSWER : 0), groupAddress, value, true);
+}
+
+KnxTxQueueResult SimpleKnx_::groupWrite4ByteFloatValue(bool answer, word groupAddress, float value, KnxPriority priority) {
+    return writeFloatValue(priority | (answer ? KNX_FLOAT_TAG_ANSWER : 0) | KNX_FLOAT_TAG_4BYTE, groupAddress, value, true);
+}
+
+// filtered is false for the values coming from the filter itself
+KnxTxQueueResult SimpleKnx_::writeFloatValue(byte tag, word groupAddress, float value, boolean filtered) {
+    KnxTxQueueResult result;
+    bool answer = tag & KNX_FLOAT_TAG_ANSWER;
+    KnxPriority priority = (KnxPriority)(tag & CONTROL_FIELD_PRIORITY_MASK);
+
+    switch (filtered ? _changeFilter.check(groupAddress, value, tag, millis()) : KNX_CHANGE_SEND) {
+        case KNX_CHANGE_SUPPRESS:
+            _txLastHandle = KNX_TX_HANDLE_NONE;
+            return KNX_TX_QUEUE_SUPPRESSED;
+
+        case KNX_CHANGE_DEFER:
+            _txLastHandle = KNX_TX_HANDLE_NONE;
+            return KNX_TX_QUEUE_DEFERRED;
+
+        default:
+            break;
+    }
+
+    if (tag & KNX_FLOAT_TAG_4BYTE) {
+        byte data[4];
+        float *f = (float*)(void*) & (data[0]);
+        *f = value;
+
+        result = appendTelegram(answer, groupAddress, data, 4, priority);
+    } else if (tag & KNX_FLOAT_TAG_CENTI) {
+        byte data[2];
+        KnxDptCodec<9>::encodeCenti(long(value * 100 + ((value < 0) ? -0.5 : 0.5)), data);
+
+        result = appendTelegram(answer, groupAddress, data, 2, priority);
     } else {
-        while (longValuex100 > (long)(2047)) {
-            exponent++;
-            round = (byte)(longValuex100)&1;
-            longValuex100 >>= 1;
-        }
+        result = append2ByteFloatValue(answer, groupAddress, value, priority);
+    }
+
+    if (result != KNX_TX_QUEUE_REJECTED) {
+        _changeFilter.sent(groupAddress, value, millis());
     }
-    
-    if (round) longValuex100++;
-    data[1] = (byte)longValuex100;
-    data[0] = (byte)(longValuex100 >> 8) & 0x7;
-    data[0] += exponent << 3;    
-    if (negativeSign) data[0] += 0x80;
 
-    appendTelegram(answer, groupAddress, data, 2);
+    return result;
 }
 
-void SimpleKnx_::groupWrite4ByteFloatValue(bool answer, word groupAddress, float value) {
-    byte data[4];
-    float *f = (float*)(void*) & (data[0]);
-    *f = value;
-    
-    appendTelegram(answer, groupAddress, data, 4);
+KnxTxQueueResult SimpleKnx_::append2ByteFloatValue(bool answer, word groupAddress, float value, KnxPriority priority) {
+    byte data[2];
+    Dpt<9, 1>::encode(value, data);
+
+    return appendTelegram(answer, groupAddress, data, 2, priority);
+}
+
+KnxTxQueueResult SimpleKnx_::groupWriteData(bool answer, word groupAddress, const byte data[], byte length, KnxPriority priority) {
+
+    // standard frame whenever possible
+    if (length <= KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 2) {
+        return appendTelegram(answer, groupAddress, data, length, priority);
+    }
+
+    _txLastHandle = KNX_TX_HANDLE_NONE;
+
+    // an extended frame is not queued, so it cannot be part of a batch
+    if (_txActionList.isBatchOpen() && !_txInTask) {
+        _txActionList.failBatch();
+        return KNX_TX_QUEUE_REJECTED;
+    }
+
+    if (_txExtPending || (length > KNX_TPUART_TX_MAX_SIZE - KNX_EXT_TELEGRAM_LENGTH_OFFSET - 1) ||
+        ((_txExtTelegram != NULL) && (_tpuart != NULL) && _tpuart->isSending(*_txExtTelegram))) {
+        return KNX_TX_QUEUE_REJECTED;
+    }
+
+    if (_txExtTelegram == NULL) {
+        _txExtTelegram = new KnxExtTelegram();
+        if (_txExtTelegram == NULL) return KNX_TX_QUEUE_REJECTED;
+    } else {
+        _txExtTelegram->clearTelegram();
+    }
+
+    _txExtTelegram->setPriority(priority);
+    _txExtTelegram->setTargetAddress(groupAddress);
+    _txExtTelegram->setCommand(answer ? KNX_COMMAND_VALUE_RESPONSE : KNX_COMMAND_VALUE_WRITE);
+    _txExtTelegram->setPayload(data, length);
+
+    DEBUG2_PRINTLN(F("groupWriteData extended ga=0x%04x length=%d"), groupAddress, length);
+
+    _txExtPending = true;
+    _txExtHandle = newTxHandle();
+    _txExtEnqueueTimeMicrosec = micros();
+    _txLastHandle = _txExtHandle;
+
+    return KNX_TX_QUEUE_APPENDED;
 }
@@ -45,16 +45,103 @@
 #include <Arduino.h>
 #include <avr/wdt.h>
 
-#include "RingBuff.h"
+#include "KnxDpt.h"
+#include "KnxTxQueue.h"
+#include "KnxTxLimiter.h"
+#include "KnxTimerWheel.h"
+#include "KnxChangeFilter.h"
 #include "KnxTpUart.h"
 
-#define ACTIONS_QUEUE_SIZE 16
+#ifndef ACTIONS_QUEUE_SIZE
+#define ACTIONS_QUEUE_SIZE 36        // telegrams at most
+#endif
+#ifndef ACTIONS_QUEUE_ARENA_SIZE
+#define ACTIONS_QUEUE_ARENA_SIZE 252 // bytes for the telegrams, see KnxTxEntry::getStoredSize
+#endif
 #define KNX_RXTASK_INTERVAL 400
 #define KNX_TXTASK_INTERVAL 800
 
 // Macro functions for conversion of physical and group addresses
-inline word P_ADDR(byte area, byte line, byte busdevice) { return (word) ( ((area&0xF)<<12) + ((line&0xF)<<8) + busdevice ); }
-inline word G_ADDR(byte maingrp, byte midgrp, byte subgrp) { return (word) ( ((maingrp&0x1F)<<11) + ((midgrp&0x7)<<8) + subgrp ); }
+constexpr word P_ADDR(byte area, byte line, byte busdevice) { return (word) ( (word(area&0xF)<<12) + (word(line&0xF)<<8) + busdevice ); }
+constexpr word G_ADDR(byte maingrp, byte midgrp, byte subgrp) { return (word) ( (word(maingrp&0x1F)<<11) + (word(midgrp&0x7)<<8) + subgrp ); }
+
+// Compile time check of the group address table: strictly ascending, so sorted and without duplicates.
+// The halves overlap by one address and are checked separately, so the recursion depth is log2(count).
+constexpr bool GROUP_ADDRESSES_VALID(const word *list, unsigned int count) {
+    return (count < 2) || ((count == 2) ? (list[0] < list[1]) :
+        (GROUP_ADDRESSES_VALID(list, count / 2 + 1) && GROUP_ADDRESSES_VALID(list + count / 2, count - count / 2)));
+}
+
+// Defines the group address table of the device in flash. Addresses must be listed in
+// ascending order, so the table can be used as lookup index as it is.
+//
+//   KNX_GROUP_ADDRESSES(G_ADDR(1,1,1), G_ADDR(1,1,2), G_ADDR(2,0,1));
+//
+#define KNX_GROUP_ADDRESSES(...) \
+    static constexpr word _groupAddressListCheck[] = { __VA_ARGS__ }; \
+    static_assert(GROUP_ADDRESSES_VALID(_groupAddressListCheck, sizeof(_groupAddressListCheck) / sizeof(word)), \
+                  "Group addresses must be listed in ascending order without duplicates"); \
+    const word SimpleKnx_::_groupAddressList[] PROGMEM = { __VA_ARGS__ }; \
+    const word SimpleKnx_::_groupAddressListSize = sizeof(_groupAddressListCheck) / sizeof(word)
+
+// Identifies a queued telegram in its completion, see telegramCompletedCallback
+typedef byte KnxTxHandle;
+#define KNX_TX_HANDLE_NONE 0
+
+// How a queued telegram ended
+enum KnxTxStatus {
+    KNX_TX_CONFIRMED = 0,   // confirmed by the TPUART
+    KNX_TX_FAILED = 1,      // not confirmed after all repetitions, or lost by a TPUART reset
+    KNX_TX_DROPPED = 2      // dropped from the queue for a newer telegram, never sent
+};
+
+// Completion of a queued telegram. The times are micros(), so differences are valid
+// for about 70 minutes: start - enqueue is the queueing delay, done - start the bus delay.
+// The enqueue time is kept in steps of KNX_TX_ENTRY_TIME_STEP while queued and is rounded
+// down to one, a telegram queued for more than 65535 steps gets a wrong one.
+typedef struct KnxTxCompletion {
+    KnxTxHandle handle;
+    word groupAddress;
+    KnxTxStatus status;
+    unsigned long enqueueTimeMicrosec; // group write called
+    unsigned long startTimeMicrosec;   // first byte written to the TPUART, same as done if never sent
+    unsigned long doneTimeMicrosec;    // confirmed, failed or dropped
+} KnxTxCompletion;
+
+// Queued telegram with what is needed to report its completion
+//
+// Only group writes and responses are queued, so all fields besides the priority, target
+// address, command and payload have their default values. In the queue a header byte holds
+// the high command bits, the priority and the payload length, followed by the target address,
+// the low command field and the rest of the payload, the handle and the enqueue time in steps
+// of KNX_TX_ENTRY_TIME_STEP: 7 bytes for a DPT 1 value. The other fields are set to their
+// defaults on load, the source address is stamped by the TPUART.
+#define KNX_TX_ENTRY_STORED_OVERHEAD 6      // stored bytes besides the payload
+#define KNX_TX_ENTRY_TIME_SHIFT 10
+#define KNX_TX_ENTRY_TIME_STEP (1UL << KNX_TX_ENTRY_TIME_SHIFT) // microseconds
+
+class KnxTxEntry {
+    public:
+        KnxTelegram telegram;
+        KnxTxHandle handle;
+        unsigned long enqueueTimeMicrosec;
+
+        // used by KnxTxQueue
+        byte getStoredSize(void) const { return telegram.getPayloadLength() + KNX_TX_ENTRY_STORED_OVERHEAD; }
+        void store(byte stored[]) const;
+        void load(const byte stored[]);
+
+        KnxPriority getPriority(void) const { return telegram.getPriority(); }
+        word getTargetAddress(void) const { return telegram.getTargetAddress(); }
+        KnxCommand getCommand(void) const { return telegram.getCommand(); }
+
+        static byte getStoredSize(const byte stored[]) { return (stored[0] & ROUTING_FIELD_PAYLOAD_LENGTH_MASK) + KNX_TX_ENTRY_STORED_OVERHEAD; }
+        static KnxPriority getPriority(const byte stored[]) { return (KnxPriority)((stored[0] >> 2) & CONTROL_FIELD_PRIORITY_MASK); }
+        static word getTargetAddress(const byte stored[]) { return stored[2] + (word(stored[1])<<8); }
+        static KnxCommand getCommand(const byte stored[]) {
+            return (KnxCommand)(((stored[3] & COMMAND_FIELD_LOW_COMMAND_MASK)>>6) + ((stored[0] >> 6)<<2));
+        }
+};
 
 // Values returned by the KnxDevice functions
 enum KnxDeviceStatus {
@@ -65,8 +152,8 @@ enum KnxDeviceStatus {
 class SimpleKnx_ {
 
     public:
-        static word _groupAddressList[];
-        static const byte _groupAddressListSize;
+        static const word _groupAddressList[]; // in PROGMEM, see KNX_GROUP_ADDRESSES
+        static const word _groupAddressListSize;
 
         static SimpleKnx_ &getInstance();
         SimpleKnx_(const SimpleKnx_ &) = delete;
@@ -74,15 +161,94 @@ class SimpleKnx_ {
         
         void init(HardwareSerial &serial, word deviceAddress);
         void task(void);
+#ifdef KNX_RX_ISR
+        void rxIsr(void);
+#endif
+
+        // bus monitor mode, captures all bus traffic until the next reset, nothing is sent
+        byte startBusmon(void);
+        byte readBusmonFrame(byte buffer[], byte bufferSize);
+
+        // silence after which an incomplete telegram is dropped, call after init
+        void setRxEopGap(word gapMicrosec);
+
+        // statistics of the queue of received telegrams, to size KNX_RX_QUEUE_SIZE
+        byte getRxQueueMaxCount(void) const;
+        byte getRxQueueOverflowCount(void) const;
+
+        // number of repeated telegrams dropped because they were delivered already
+        byte getRxDuplicateCount(void) const;
         
-        void groupWriteBool(bool answer, word groupAddress, bool value);
-        void groupWrite2BitIntValue(bool answer, word groupAddress, byte value);
-        void groupWrite4BitIntValue(bool answer, word groupAddress, byte value);
-        void groupWrite1ByteIntValue(bool answer, word groupAddress, byte value);
-        void groupWrite2ByteIntValue(bool answer, word groupAddress, int value);
-        void groupWrite4ByteIntValue(bool answer, word groupAddress, long value);
-        void groupWrite2ByteFloatValue(bool answer, word groupAddress, float value);
-        void groupWrite4ByteFloatValue(bool answer, word groupAddress, float value);
+        // what to do when the tx queue is full, KNX_TX_QUEUE_EVICT by default
+        void setTxQueuePolicy(KnxTxQueuePolicy policy);
+
+        // replace pending telegrams by newer ones for the same group address, off by default
+        void setTxCoalescing(boolean coalescing);
+
+        // number of telegrams dropped or refused because the tx queue was full
+        byte getTxQueueDropCount(void) const;
+
+        // repetitions of a telegram the TPUART did not confirm, KNX_TX_RETRIES by default
+        void setTxRetries(byte retries);
+
+        // number of telegrams not confirmed after all repetitions, see telegramSendFailedCallback
+        byte getTxFailedCount(void) const;
+
+        // token bucket limits for outgoing telegrams, for all or for single group addresses.
+        // Limited telegrams wait in the queue. Rate is in telegrams per second, 0 is unlimited.
+        void setTxRateLimit(byte rate, byte burst);
+        boolean setTxRateLimit(word groupAddress, byte rate, byte burst);
+        word getTxThrottledCount(void) const;
+        word getTxThrottledCount(word groupAddress) const;
+
+        // calls cyclicSendCallback for groupAddress every periodMillisec, the first time after a random
+        // part of it. Period 0 stops it. Returns false if KNX_CYCLIC_SIZE group addresses are cyclic already.
+        boolean setCyclicSend(word groupAddress, unsigned long periodMillisec);
+
+        // send on change for the float group writes of groupAddress: values within deadband (absolute,
+        // or in percent of the last value sent if relative) of the last value sent are suppressed,
+        // changes within minIntervalMillisec after it are deferred, and the last value is repeated
+        // after maxSilenceSec without telegram (0 is never). Returns false if KNX_CHANGE_FILTER_SIZE
+        // group addresses are filtered already.
+        boolean setSendOnChange(word groupAddress, float deadband, boolean relative = false,
+                                word minIntervalMillisec = 0, word maxSilenceSec = 0);
+
+        // group writes between beginTxBatch and commitTxBatch are queued all together or not at all,
+        // and sent back to back at the batch priority. Writes made from within task() are not part of
+        // the batch. beginTxBatch returns false if a batch is open or the queue has no room for count
+        // telegrams of size bytes of data, see KnxDptCodec::size. The room is kept for the batch until
+        // it is committed. commitTxBatch returns false if a member was rejected, then all members are
+        // reported as KNX_TX_DROPPED. Extended frames, more than count members and members larger than
+        // size are rejected.
+        boolean beginTxBatch(byte count, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE, byte size = KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 2);
+        boolean commitTxBatch(void);
+        void abortTxBatch(void);
+
+        // handle of the telegram queued by the last group write, KNX_TX_HANDLE_NONE if it was rejected
+        KnxTxHandle getLastTxHandle(void) const;
+
+        // all group writes return if the telegram was queued, see KnxTxQueue.h
+        KnxTxQueueResult groupWriteBool(bool answer, word groupAddress, bool value, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE);
+        KnxTxQueueResult groupWrite2BitIntValue(bool answer, word groupAddress, byte value, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE);
+        KnxTxQueueResult groupWrite4BitIntValue(bool answer, word groupAddress, byte value, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE);
+        KnxTxQueueResult groupWrite1ByteIntValue(bool answer, word groupAddress, byte value, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE);
+        KnxTxQueueResult groupWrite2ByteIntValue(bool answer, word groupAddress, int value, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE);
+        KnxTxQueueResult groupWrite4ByteIntValue(bool answer, word groupAddress, long value, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE);
+        KnxTxQueueResult groupWrite2ByteFloatValue(bool answer, word groupAddress, float value, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE);
+        KnxTxQueueResult groupWrite4ByteFloatValue(bool answer, word groupAddress, float value, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE);
+
+        // 2 byte float from hundredths, e.g. 2150 for 21.5, without float arithmetic unless the group
+        // address is sent on change, the filter compares the value as float then.
+        KnxTxQueueResult groupWrite2ByteFixedValue(bool answer, word groupAddress, long centi, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE);
+
+        // writes a value of any datapoint type of KnxDpt.h, e.g. groupWrite<Dpt<9, 1>>(false, ga, 21.5).
+        // Unlike groupWrite2ByteFloatValue it does not pass the send on change filter.
+        template<typename D>
+        KnxTxQueueResult groupWrite(bool answer, word groupAddress, const typename D::Type& value, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE);
+
+        // sends length bytes behind the command field, in an extended frame if they do not fit
+        // into a standard one. Only one extended frame can be pending, the next one is rejected.
+        KnxTxQueueResult groupWriteData(bool answer, word groupAddress, const byte data[], byte length, KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE);
  
     private:
         SimpleKnx_();
@@ -91,19 +257,67 @@ class SimpleKnx_ {
         word _lastRXTimeMicros;
         word _lastTXTimeMicros;
         KnxTpUart *_tpuart;
-        KnxTelegram *_rxTelegram;
-        KnxTelegram _txTelegram;        
-        RingBuff<KnxTelegram, ACTIONS_QUEUE_SIZE> _txActionList;
+        KnxTxEntry _txEntry[2];           // on the bus and prepared next, see KnxTpUart::sendNextTelegram
+        byte _txEntryIndex;               // buffer to be used next
+        KnxTxQueue<KnxTxEntry, ACTIONS_QUEUE_SIZE, ACTIONS_QUEUE_ARENA_SIZE> _txActionList;
+        KnxTxLimiter _txLimiter;
+        KnxTimerWheel _cyclic;
+        KnxChangeFilter _changeFilter;
+        KnxExtTelegram *_txExtTelegram;   // allocated with the first extended frame sent
+        boolean _txExtPending;
+        KnxTxHandle _txExtHandle;         // handle of _txExtTelegram until it is completed
+        unsigned long _txExtEnqueueTimeMicrosec;
+        KnxTxHandle _txLastHandle;        // handle given by the last group write
+        KnxTxHandle _txNextHandle;        // handle to be given next
+        KnxPriority _txBatchPriority;     // priority of all members of the open batch
+        boolean _txInTask;                // task is running, its group writes are not part of a batch
+        byte _txRetries;
+        byte _txFailedCount;
 
         void reboot();
         KnxDeviceStatus begin(HardwareSerial& serial);
         void end();
 
-        void appendTelegram(bool answer, word groupAddress, byte data[], byte length);
+        KnxTxQueueResult appendTelegram(bool answer, word groupAddress, const byte data[], byte length, KnxPriority priority);
+        KnxTxQueueResult writeFloatValue(byte tag, word groupAddress, float value, boolean filtered);
+        KnxTxQueueResult append2ByteFloatValue(bool answer, word groupAddress, float value, KnxPriority priority);
+        KnxTxHandle newTxHandle(void);
+        void txCompleted(KnxTxHandle& handle, word groupAddress, unsigned long enqueueTime, boolean started, KnxTxStatus status);
+        void txSentCompleted(KnxTxStatus status);
         static void getTpUartEvents(KnxTpUartEvent event);
 };
 
-extern void telegramEventCallback(KnxTelegram telegram);
+template<typename D>
+inline KnxTxQueueResult SimpleKnx_::groupWrite(bool answer, word groupAddress, const typename D::Type& value, KnxPriority priority) {
+    static_assert(D::size <= KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 2, "datapoint type does not fit into a standard frame");
+
+    byte data[D::size ? D::size : 1];
+    D::encode(value, data);
+
+    return appendTelegram(answer, groupAddress, data, D::size, priority);
+}
+
+// called for every received telegram matching the group address list, the
+// telegram is only valid during the call
+extern void telegramReceivedCallback(const KnxTelegram& telegram);
+
+// deprecated, copies the telegram, implement telegramReceivedCallback instead
+extern void telegramEventCallback(KnxTelegram telegram) __attribute__((weak));
+
+// called for every telegram that could not be sent after all repetitions. Optional.
+extern void telegramSendFailedCallback(word groupAddress) __attribute__((weak));
+
+// called once for every telegram queued by a group write when it is confirmed, failed or
+// dropped. It may run within task() or within the group write dropping it, so keep it short. Optional.
+extern void telegramCompletedCallback(const KnxTxCompletion& completion) __attribute__((weak));
+
+// called when the value of a group address set with setCyclicSend is due, write it with one
+// of the group write functions. Optional.
+extern void cyclicSendCallback(word groupAddress) __attribute__((weak));
+
+// called for every received extended telegram matching the group address list, the
+// telegram is only valid during the call. Optional, extended telegrams are dropped without it.
+extern void extTelegramReceivedCallback(const KnxExtTelegram& telegram) __attribute__((weak));
 extern SimpleKnx_ &SimpleKnx;
 
 #endif
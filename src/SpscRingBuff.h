@@ -0,0 +1,127 @@
+/*
+ *    SpscRingBuff.h
+ *
+ *    Written by Christian Poulter.
+ *
+ *    Copyright (C) 2023 Christian Poulter <devel(at)poulter.de>
+ *    All rights reserved. This file is now part of the Ardunio SimpleKnx Library.
+ *
+ *    The Ardunio SimpleKnx Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SPSCRINGBUFF_H
+#define SPSCRINGBUFF_H
+
+#include "Arduino.h"
+
+// keeps the compiler from moving buffer accesses across the index updates
+#define SPSC_MEMORY_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
+/*
+ * Single producer / single consumer ring buffer without locks.
+ *
+ * The producer (usually an interrupt service routine) only writes _tail,
+ * the consumer (usually the main loop) only writes _head. As byte reads and
+ * writes are atomic on AVR, no interrupt has to be disabled on either side.
+ * One slot is always kept free to tell a full from an empty buffer.
+ */
+template<typename T, byte size>
+class SpscRingBuff {
+    static_assert(size >= 2 && (size & (size - 1)) == 0, "size must be a power of two");
+
+    volatile byte _head;
+    volatile byte _tail;
+    volatile byte _overflowCount;
+    T _buffer[size]; // item buffer
+
+public:
+
+    /**
+     * Constructor
+     */
+    SpscRingBuff() {
+        _head = 0;
+        _tail = 0;
+        _overflowCount = 0;
+    };
+
+    /**
+     * Push data to tail, producer side only
+     * @param data
+     * @return false, if the buffer is full and the data was dropped
+     */
+    boolean push(const T& data) {
+        byte tail = _tail;
+        byte next = (tail + 1) & (size - 1);
+
+        if (next == _head) {
+            if (_overflowCount < 255) _overflowCount++;
+            return false;
+        }
+
+        _buffer[tail] = data;
+        SPSC_MEMORY_BARRIER();
+        _tail = next;
+
+        return true;
+    }
+
+    /**
+     * Pop data from head, consumer side only
+     * @param data the popped data
+     * @return false, if no items available
+     */
+    boolean pop(T& data) {
+        byte head = _head;
+        if (head == _tail) return false;
+
+        data = _buffer[head];
+        SPSC_MEMORY_BARRIER();
+        _head = (head + 1) & (size - 1);
+
+        return true;
+    }
+
+    /**
+     * Drop all items, consumer side only
+     */
+    void clear(void) {
+        _head = _tail;
+    }
+
+    /**
+     * Returns true if no items are available
+     */
+    boolean isEmpty(void) const {
+        return _head == _tail;
+    }
+
+    /**
+     * Returns number of items in buffer
+     * @return item count
+     */
+    byte getItemCount(void) const {
+        return (_tail - _head) & (size - 1);
+    }
+
+    /**
+     * Returns number of items dropped because the buffer was full (saturates at 255)
+     */
+    byte getOverflowCount(void) const {
+        return _overflowCount;
+    }
+};
+
+#endif // SPSCRINGBUFF_H